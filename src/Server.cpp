@@ -1,46 +1,341 @@
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "matcher.hpp"
 
 using std::cerr;
-using std::cin;
-using std::cout;
 using std::endl;
+using std::exception;
 using std::getline;
+using std::ifstream;
+using std::invalid_argument;
+using std::isdigit;
+using std::max;
+using std::min;
 using std::runtime_error;
+using std::stoull;
 using std::string;
-using std::unitbuf;
+using std::thread;
 using std::vector;
 
+namespace{
+    constexpr unsigned long MAX_THREAD_COUNT = 1024;
+
+    const string BACKTRACK_MEMORY_OPT = "--backtrack-memory=";
+    const string CHUNK_SIZE_OPT = "--chunk-size=";
+    const string COUNT_OPT = "-c";
+    const string DFA_CACHE_SIZE_OPT = "--dfa-cache-size=";
+    const string END_OF_OPTIONS = "--";
+    const string FILES_WITH_MATCHES_OPT = "-l";
+    const string LINE_BY_LINE_OPT = "--line-by-line";
+    const string MAX_COUNT_OPT = "-m";
+    const string MMAP_THRESHOLD_OPT = "--mmap-threshold=";
+    const string ORDERED_OPT = "--ordered";
+    const string PATTERN_OPT = "-e";
+    const string PATTERN_FILE_OPT = "-f";
+    const string QUIET_OPT = "-q";
+    const string SHOW_PATTERN_OPT = "--show-pattern";
+    const string THREADS_OPT = "-j";
+    const string TRACE_OPT = "--trace";
+
+    /**
+     * Parse an unsigned decimal number, without the sign or the leading whitespace stoull would accept.
+     * @param value The text to parse.
+     * @return The parsed number.
+     * @throw invalid_argument if the text isn't only made of digits.
+     * @throw out_of_range if the number is too large.
+     */
+    unsigned long long parse_unsigned(const string& value){
+        if (value.empty() || !isdigit(static_cast<unsigned char>(value.front()))){
+            throw invalid_argument("Not a number: " + value);
+        }
+        size_t end = 0;
+        unsigned long long number = stoull(value, &end);
+        if (end != value.size()){
+            throw invalid_argument("Not a number: " + value);
+        }
+        return number;
+    }
+
+    /**
+     * Parse the size given to a long option.
+     * @param arg The whole argument, option name included.
+     * @param option The option's name, up to and including the '=' sign.
+     * @param description What the size is, for error messages.
+     * @return The parsed size.
+     * @throw runtime_error if the value isn't a valid size.
+     */
+    size_t parse_size_option(const string& arg, const string& option, const string& description){
+        string value = arg.substr(option.size());
+        try{
+            return parse_unsigned(value);
+        }
+        catch (const exception& e){
+            throw runtime_error("Invalid " + description + ": " + value);
+        }
+    }
+
+    /**
+     * Parse the line count given to -m.
+     * @param value The option's value.
+     * @return The maximum amount of matched lines per file.
+     * @throw runtime_error if the value isn't a valid count.
+     */
+    size_t parse_max_count(const string& value){
+        try{
+            return parse_unsigned(value);
+        }
+        catch (const exception& e){
+            throw runtime_error("Invalid max count: " + value);
+        }
+    }
+
+    /**
+     * Ask for an output mode, unless one which takes precedence over it was asked for already.
+     * @param options The search options to update.
+     * @param mode The output mode asked for.
+     */
+    void request_output_mode(cpp_grep::SearchOptions& options, cpp_grep::EOutputMode mode){
+        options.output_mode = max(options.output_mode, mode);
+    }
+
+    /**
+     * Parse the thread count given to -j.
+     * @param value The option's value. 0 means one thread per hardware thread.
+     * @return The amount of threads to use.
+     * @throw runtime_error if the value isn't a valid thread count.
+     */
+    uint32_t parse_thread_count(const string& value){
+        unsigned long long count;
+        try{
+            count = parse_unsigned(value);
+        }
+        catch (const exception& e){
+            throw runtime_error("Invalid thread count: " + value);
+        }
+        if (count == 0){
+            return max(1u, thread::hardware_concurrency());
+        }
+        return static_cast<uint32_t>(min<unsigned long long>(count, MAX_THREAD_COUNT));
+    }
+
+    /**
+     * Enable tracing.
+     * @param arg The whole argument: --trace (debug level) or --trace=LEVEL.
+     * @throw runtime_error if the level is invalid, or if this is a release build.
+     */
+    void enable_tracing(const string& arg){
+        #ifdef CPP_GREP_TRACING
+        cpp_grep::ETraceLevel level = cpp_grep::ETraceLevel::DEBUG;
+        if (arg.size() > TRACE_OPT.size()){
+            string name = arg.substr(TRACE_OPT.size() + 1);
+            if (arg[TRACE_OPT.size()] != '=' || !cpp_grep::parse_trace_level(name, level)){
+                throw runtime_error("Invalid trace level: " + arg.substr(TRACE_OPT.size()) + " (expected info, debug or verbose)");
+            }
+        }
+        cpp_grep::set_trace_level(level);
+        #else
+        throw runtime_error(arg + " is only available in debug builds");
+        #endif
+    }
+
+    /**
+     * Read the patterns listed in a file, one per line.
+     * @param path The path to the file.
+     * @return The patterns, in the file's order.
+     * @throw runtime_error if the file can't be opened.
+     */
+    vector<string> read_pattern_file(const string& path){
+        ifstream file(path);
+        if (!file){
+            throw runtime_error("Cannot open pattern file " + path);
+        }
+        vector<string> patterns;
+        string pattern;
+        while (getline(file, pattern)){
+            patterns.push_back(pattern);
+        }
+        return patterns;
+    }
+
+    /**
+     * @brief Extract the options from the command line, leaving the positional arguments in place.
+     * Options are read up to the first positional argument after the mode flag (-E or -F), i.e. the pattern,
+     * or the first path when -e or -f is used, or up to "--". Later arguments are all positional,
+     * even if they start with '-'.
+     * @param argc The argument count, as given to main.
+     * @param argv The argument values, as given to main.
+     * @param options The search options to fill.
+     * @param patterns The patterns given with -e and -f are appended to it, in order.
+     * @param patterns_given Set to true if -e or -f was used.
+     * @return The remaining arguments, program name included.
+     * @throw runtime_error if an option has an invalid value, or if a pattern file can't be read.
+     */
+    vector<string> parse_long_options(int argc, char* argv[], cpp_grep::SearchOptions& options, vector<string>& patterns, bool& patterns_given){
+        vector<string> args;
+        args.reserve(argc);
+        bool mode_given = false;
+        for (int i = 0; i < argc; ++i){
+            string arg = argv[i];
+            if (i == 0){
+                args.push_back(arg);
+                continue;
+            }
+            if (arg == END_OF_OPTIONS){
+                args.insert(args.end(), argv + i + 1, argv + argc);
+                break;
+            }
+            if (arg.starts_with(BACKTRACK_MEMORY_OPT)){
+                options.backtrack_memory = parse_size_option(arg, BACKTRACK_MEMORY_OPT, "backtracking memory limit");
+                continue;
+            }
+            if (arg.starts_with(CHUNK_SIZE_OPT)){
+                options.chunk_size = parse_size_option(arg, CHUNK_SIZE_OPT, "chunk size");
+                continue;
+            }
+            if (arg == COUNT_OPT){
+                request_output_mode(options, cpp_grep::EOutputMode::COUNT);
+                continue;
+            }
+            if (arg.starts_with(DFA_CACHE_SIZE_OPT)){
+                options.dfa_cache_size = parse_size_option(arg, DFA_CACHE_SIZE_OPT, "DFA cache size");
+                continue;
+            }
+            if (arg == FILES_WITH_MATCHES_OPT){
+                request_output_mode(options, cpp_grep::EOutputMode::FILES_WITH_MATCHES);
+                continue;
+            }
+            if (arg == MAX_COUNT_OPT){
+                if (i + 1 >= argc){
+                    throw runtime_error("Expected a count after " + MAX_COUNT_OPT);
+                }
+                options.max_count = parse_max_count(argv[++i]);
+                continue;
+            }
+            if (arg.starts_with(MAX_COUNT_OPT) && arg.size() > MAX_COUNT_OPT.size()){
+                options.max_count = parse_max_count(arg.substr(MAX_COUNT_OPT.size()));
+                continue;
+            }
+            if (arg.starts_with(MMAP_THRESHOLD_OPT)){
+                options.mmap_threshold = parse_size_option(arg, MMAP_THRESHOLD_OPT, "mmap threshold");
+                continue;
+            }
+            if (arg == ORDERED_OPT){
+                options.ordered_output = true;
+                continue;
+            }
+            if (arg == PATTERN_OPT){
+                if (i + 1 >= argc){
+                    throw runtime_error("Expected a pattern after " + PATTERN_OPT);
+                }
+                patterns.emplace_back(argv[++i]);
+                patterns_given = true;
+                continue;
+            }
+            if (arg == PATTERN_FILE_OPT){
+                if (i + 1 >= argc){
+                    throw runtime_error("Expected a file after " + PATTERN_FILE_OPT);
+                }
+                vector<string> file_patterns = read_pattern_file(argv[++i]);
+                patterns.insert(patterns.end(), file_patterns.begin(), file_patterns.end());
+                patterns_given = true;
+                continue;
+            }
+            if (arg == QUIET_OPT){
+                request_output_mode(options, cpp_grep::EOutputMode::QUIET);
+                continue;
+            }
+            if (arg == SHOW_PATTERN_OPT){
+                options.show_pattern = true;
+                continue;
+            }
+            if (arg == THREADS_OPT){
+                if (i + 1 >= argc){
+                    throw runtime_error("Expected a thread count after " + THREADS_OPT);
+                }
+                options.thread_count = parse_thread_count(argv[++i]);
+                continue;
+            }
+            if (arg.starts_with(THREADS_OPT) && arg.size() > THREADS_OPT.size()){
+                options.thread_count = parse_thread_count(arg.substr(THREADS_OPT.size()));
+                continue;
+            }
+            if (arg.starts_with(TRACE_OPT)){
+                enable_tracing(arg);
+                continue;
+            }
+            if (arg == LINE_BY_LINE_OPT){
+                options.whole_buffer = false;
+                continue;
+            }
+            args.push_back(arg);
+            if (mode_given){
+                args.insert(args.end(), argv + i + 1, argv + argc);
+                break;
+            }
+            mode_given = arg == "-E" || arg == "-F";
+        }
+        return args;
+    }
+}
+
 int main(int argc, char* argv[]) {
-    // Flush after every std::cout / std::cerr
-    cout << unitbuf;
-    cerr << unitbuf;
+    // Matched lines go through a buffered sink: only diagnostics are flushed right away.
+    cerr << std::unitbuf;
+
+    cpp_grep::SearchOptions options;
+    vector<string> patterns;
+    bool patterns_given = false;
+    vector<string> args;
+    try{
+        args = parse_long_options(argc, argv, options, patterns, patterns_given);
+    }
+    catch (const runtime_error& e){
+        cerr << e.what() << endl;
+        return 1;
+    }
+    argc = static_cast<int>(args.size());
 
-    // You can use print statements as follows for debugging, they'll be visible when running tests.
-    cerr << "Logs from your program will appear here" << endl;
+    // With -e or -f, there is no pattern argument after the mode flag.
+    int pattern_args = patterns_given ? 0 : 1;
 
-    if (argc < 3) {
+    if (argc < 2 + pattern_args) {
         cerr << "Expected at least two arguments" << endl;
         return 1;
     }
 
-    string flag = argv[1];
+    string flag = args[1];
 
-    if (argc == 5 && flag == "-r"){
-        string second_flag = argv[2];
-        if (second_flag != "-E"){
-            cerr << "Expected second argument to be '-E' because '-r' was the first argument\n";
-            return 1;
-        }
-        string pattern = argv[3];
-        string directory = argv[4];
+    bool recursive = flag == "-r";
+    int mode_index = recursive ? 2 : 1;
+    if (recursive && (argc != 4 + pattern_args || (args[2] != "-E" && args[2] != "-F"))){
+        cerr << "Expected second argument to be '-E' or '-F' because '-r' was the first argument\n";
+        return 1;
+    }
+    string mode = args[mode_index];
+    if (mode != "-E" && mode != "-F") {
+        cerr << "Expected first argument to be '-r', '-E' or '-F'" << endl;
+        return 1;
+    }
+    options.fixed_strings = mode == "-F";
+
+    if (!patterns_given){
+        patterns.push_back(args[mode_index + 1]);
+    }
+    int first_path = mode_index + 1 + pattern_args;
+
+    if (recursive){
+        string directory = args[first_path];
 
         try{
-            if (cpp_grep::match_in_directory_recursive(directory, pattern)){
+            if (cpp_grep::match_in_directory_recursive(directory, patterns, options)){
                 return 0;
             }
             else{
@@ -53,21 +348,14 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    string pattern = argv[2];
-
-    if (flag != "-E") {
-        cerr << "Expected first argument to be '-r' or '-E'" << endl;
-        return 1;
-    }
-
-    if (argc > 4){
+    if (argc > first_path + 1){
         vector<string> file_paths;
-        file_paths.reserve(argc - 3);
-        for (int i = 3; i < argc; ++i){
-            file_paths.emplace_back(argv[i]);
+        file_paths.reserve(argc - first_path);
+        for (int i = first_path; i < argc; ++i){
+            file_paths.emplace_back(args[i]);
         }
         try{
-            if (cpp_grep::match_in_files(file_paths, pattern)){
+            if (cpp_grep::match_in_files(file_paths, patterns, options)){
                 return 0;
             }
             else{
@@ -80,10 +368,10 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    if (argc == 4){
-        string file = argv[3];
+    if (argc == first_path + 1){
+        string file = args[first_path];
         try{
-            if (cpp_grep::match_in_file(file, pattern)){
+            if (cpp_grep::match_in_file(file, patterns, options)){
                 return 0;
             }
             else{
@@ -96,17 +384,16 @@ int main(int argc, char* argv[]) {
         }
     }
 
-     string input_line;
-     getline(cin, input_line);
-
-     try {
-         if (cpp_grep::match_pattern(input_line, pattern)) {
-             return 0;
-         } else {
-             return 1;
-         }
-     } catch (const runtime_error& e) {
-         cerr << e.what() << endl;
-         return 1;
-     }
+    try{
+        if (cpp_grep::match_stdin(patterns, options)){
+            return 0;
+        }
+        else{
+            return 1;
+        }
+    }
+    catch (const runtime_error& e){
+        cerr << e.what() << endl;
+        return 1;
+    }
 }
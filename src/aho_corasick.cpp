@@ -0,0 +1,210 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <algorithm>
+#include <utility>
+
+#include "aho_corasick.hpp"
+
+namespace cpp_grep{
+    using std::lower_bound;
+    using std::pair;
+    using std::sort;
+
+    namespace priv{
+        /**
+         * @brief A trie node, only used while building the automaton.
+         */
+        struct TrieNode{
+            vector<pair<ubyte, uint>> children;     // Unsorted while building.
+            uint pattern{UINT32_MAX};               // First pattern ending exactly at this node.
+        };
+    }
+
+    AhoCorasick::AhoCorasick(const vector<string>& patterns){
+        // Build the trie. Root children are looked up in a table, as the root has the most of them.
+        vector<priv::TrieNode> trie(1);
+        array<uint, 256> trie_root{};
+        trie_root.fill(ROOT);
+        ByteSet starts;
+        for (uint index = 0; index < patterns.size(); ++index){
+            const string& pattern = patterns[index];
+            if (pattern.empty()){
+                if (empty_pattern == NO_MATCH){
+                    empty_pattern = index;
+                }
+                continue;
+            }
+            starts.insert(static_cast<ubyte>(pattern.front()));
+            uint node = ROOT;
+            for (char chr: pattern){
+                auto byte = static_cast<ubyte>(chr);
+                uint child = ROOT;
+                if (node == ROOT){
+                    child = trie_root[byte];
+                }
+                else{
+                    for (const auto& [edge, target]: trie[node].children){
+                        if (edge == byte){
+                            child = target;
+                            break;
+                        }
+                    }
+                }
+                if (child == ROOT){
+                    child = static_cast<uint>(trie.size());
+                    trie.emplace_back();
+                    if (node == ROOT){
+                        trie_root[byte] = child;
+                    }
+                    else{
+                        trie[node].children.emplace_back(byte, child);
+                    }
+                }
+                node = child;
+            }
+            if (trie[node].pattern == NO_MATCH){
+                trie[node].pattern = index;
+            }
+        }
+        for (uint chr = 0; chr < 256; ++chr){
+            if (trie_root[chr] != ROOT){
+                trie[ROOT].children.emplace_back(static_cast<ubyte>(chr), trie_root[chr]);
+            }
+        }
+        first_bytes = ClassScanner(starts);
+
+        // Renumber the states in breadth-first order, which is also the order failure links are computed in.
+        vector<uint> order;
+        order.reserve(trie.size());
+        vector<uint> new_ids(trie.size());
+        order.push_back(ROOT);
+        new_ids[ROOT] = ROOT;
+        for (size_t head = 0; head < order.size(); ++head){
+            auto& children = trie[order[head]].children;
+            sort(children.begin(), children.end());
+            for (const auto& [edge, target]: children){
+                new_ids[target] = static_cast<uint>(order.size());
+                order.push_back(target);
+            }
+        }
+
+        size_t state_count = trie.size();
+        trans_start.assign(state_count + 1, 0);
+        fail.assign(state_count, ROOT);
+        match.assign(state_count, NO_MATCH);
+        own_pattern.assign(state_count, NO_MATCH);
+        output_link.assign(state_count, ROOT);
+        trans_bytes.reserve(state_count - 1);
+        trans_targets.reserve(state_count - 1);
+        for (uint state = 0; state < state_count; ++state){
+            const priv::TrieNode& node = trie[order[state]];
+            trans_start[state] = static_cast<uint>(trans_bytes.size());
+            match[state] = node.pattern;
+            own_pattern[state] = node.pattern;
+            for (const auto& [edge, target]: node.children){
+                trans_bytes.push_back(edge);
+                trans_targets.push_back(new_ids[target]);
+            }
+        }
+        trans_start[state_count] = static_cast<uint>(trans_bytes.size());
+
+        root_next.fill(ROOT);
+        for (uint index = trans_start[ROOT]; index < trans_start[ROOT + 1]; ++index){
+            root_next[trans_bytes[index]] = trans_targets[index];
+        }
+
+        // Breadth-first order means a state's failure target is always complete before the state itself.
+        for (uint state = 0; state < state_count; ++state){
+            for (uint index = trans_start[state]; index < trans_start[state + 1]; ++index){
+                uint child = trans_targets[index];
+                fail[child] = state == ROOT ? ROOT : next_state(fail[state], trans_bytes[index]);
+                if (match[child] == NO_MATCH){
+                    match[child] = match[fail[child]];
+                }
+                output_link[child] = own_pattern[fail[child]] != NO_MATCH ? fail[child] : output_link[fail[child]];
+            }
+        }
+    }
+
+    /**
+     * Follow a transition, going through failure links until a state has one for the byte.
+     * @param state The current state.
+     * @param chr The byte read.
+     * @return The next state.
+     */
+    uint AhoCorasick::next_state(uint state, ubyte chr) const{
+        while (state != ROOT){
+            const ubyte* first = trans_bytes.data() + trans_start[state];
+            const ubyte* last = trans_bytes.data() + trans_start[state + 1];
+            const ubyte* found = lower_bound(first, last, chr);
+            if (found != last && *found == chr){
+                return trans_targets[found - trans_bytes.data()];
+            }
+            state = fail[state];
+        }
+        return root_next[chr];
+    }
+
+    size_t AhoCorasick::find(string_view text, uint& pattern) const{
+        if (empty_pattern != NO_MATCH){
+            pattern = empty_pattern;
+            return 0;
+        }
+
+        const char* data = text.data();
+        size_t size = text.size();
+        uint state = ROOT;
+        size_t pos = 0;
+        while (pos < size){
+            if (state == ROOT){
+                pos += first_bytes.find_first(data + pos, size - pos);
+                if (pos == size){
+                    break;
+                }
+            }
+            state = next_state(state, static_cast<ubyte>(data[pos]));
+            pos++;
+            if (match[state] != NO_MATCH){
+                pattern = match[state];
+                return pos;
+            }
+        }
+        return string_view::npos;
+    }
+
+    void AhoCorasick::find_all(string_view text, vector<uint>& patterns) const{
+        if (empty_pattern != NO_MATCH){
+            patterns.push_back(empty_pattern);
+        }
+
+        const char* data = text.data();
+        size_t size = text.size();
+        uint state = ROOT;
+        size_t pos = 0;
+        while (pos < size){
+            if (state == ROOT){
+                pos += first_bytes.find_first(data + pos, size - pos);
+                if (pos == size){
+                    break;
+                }
+            }
+            state = next_state(state, static_cast<ubyte>(data[pos]));
+            pos++;
+            if (match[state] == NO_MATCH){
+                continue;
+            }
+            // Every pattern ending here is a suffix of the current state, found along the output links.
+            for (uint found = state; found != ROOT; found = output_link[found]){
+                if (own_pattern[found] != NO_MATCH){
+                    patterns.push_back(own_pattern[found]);
+                }
+            }
+        }
+    }
+
+    size_t AhoCorasick::get_state_count() const{
+        return fail.size();
+    }
+}
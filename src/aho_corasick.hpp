@@ -0,0 +1,79 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "class_scan.hpp"
+
+namespace cpp_grep{
+    using ubyte = uint8_t;
+    using uint = uint32_t;
+
+    using std::array;
+    using std::string;
+    using std::string_view;
+    using std::vector;
+
+    /**
+     * @brief An Aho-Corasick automaton finding many literal strings in a single pass.
+     *
+     * States are numbered in breadth-first order, so the shallow states visited on almost every byte
+     * are packed together at the start of the tables. The root's transitions are a full 256-entry table,
+     * every other state stores its transitions as a sorted run inside one shared array, and missing
+     * transitions go through failure links. While in the root, bytes which can't start any pattern are
+     * skipped with a vectorised class scan.
+     */
+    class AhoCorasick{
+        static constexpr uint ROOT = 0;
+        static constexpr uint NO_MATCH = UINT32_MAX;
+
+        array<uint, 256> root_next{};
+        vector<uint> trans_start;       // Per state: index of its first transition. One extra entry ends the last run.
+        vector<ubyte> trans_bytes;      // Transition bytes, sorted within each state's run.
+        vector<uint> trans_targets;     // Transition targets, parallel to trans_bytes.
+        vector<uint> fail;              // Per state: the state for the longest proper suffix which is also a prefix.
+        vector<uint> match;             // Per state: a pattern ending at this state (or at one of its suffixes), or NO_MATCH.
+        vector<uint> own_pattern;       // Per state: the first pattern spelling out exactly this state, or NO_MATCH.
+        vector<uint> output_link;       // Per state: the closest state along its failure links with an own pattern, or ROOT.
+        ClassScanner first_bytes;       // Bytes which start at least one pattern.
+        uint empty_pattern{NO_MATCH};   // The first empty pattern, which matches everywhere, or NO_MATCH.
+
+        [[nodiscard]] uint next_state(uint state, ubyte chr) const;
+
+        public:
+            /**
+             * Build an automaton finding the given patterns.
+             * @param patterns The patterns. None of them may contain a newline.
+             */
+            explicit AhoCorasick(const vector<string>& patterns);
+
+            /**
+             * @brief Find the first position of a text at which one of the patterns ends.
+             * @param text The text to search.
+             * @param pattern Set to the index of a pattern ending there, if one was found.
+             * @return The index right after the end of the occurrence, or string_view::npos if there isn't any.
+             * An empty pattern is found at index 0.
+             */
+            [[nodiscard]] size_t find(string_view text, uint& pattern) const;
+
+            /**
+             * @brief Find every pattern occurring in a text.
+             * @param text The text to search.
+             * @param patterns The indices of the patterns found are appended to it, possibly more than once.
+             */
+            void find_all(string_view text, vector<uint>& patterns) const;
+
+            /**
+             * Get the amount of states of the automaton.
+             * @return The amount of states, root included.
+             */
+            [[nodiscard]] size_t get_state_count() const;
+    };
+}
@@ -0,0 +1,308 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <algorithm>
+
+#include "bit_state.hpp"
+
+namespace cpp_grep{
+    using std::equal;
+    using std::fill;
+    using std::find;
+
+    namespace priv{
+        /**
+         * Hash a memo key.
+         * @param key The key's first value.
+         * @param size The amount of values in the key.
+         * @return The key's hash.
+         */
+        uint64_t hash_memo_key(const uint* key, size_t size){
+            uint64_t hash = 0x9E3779B97F4A7C15ull;
+            for (size_t i = 0; i < size; ++i){
+                hash = (hash ^ key[i]) * 0xFF51AFD7ED558CCDull;
+                hash ^= hash >> 32;
+            }
+            return hash;
+        }
+    }
+
+    BitState::BitState(const Program& program, size_t memory_limit)
+    : program(&program),
+      memory_limit(memory_limit),
+      captures(2 * program.group_count, UNSET){
+        const auto& insts = program.insts;
+        for (const Inst& inst: insts){
+            if (inst.op != EOpcode::BACKREF){
+                continue;
+            }
+            for (uint slot: {2u * inst.arg, 2u * inst.arg + 1}){
+                if (find(key_slots.begin(), key_slots.end(), slot) == key_slots.end()){
+                    key_slots.push_back(slot);
+                }
+            }
+        }
+
+        // A slot is live at an instruction if a backreference may read it before a SAVE overwrites it.
+        // Propagate backwards until nothing changes: loops make a single pass insufficient.
+        size_t slot_count = key_slots.size();
+        live_slots.assign(insts.size() * slot_count, false);
+        bool changed = true;
+        while (changed){
+            changed = false;
+            for (size_t pc = insts.size(); pc-- > 0;){
+                const Inst& inst = insts[pc];
+                for (size_t index = 0; index < slot_count; ++index){
+                    if (live_slots[pc * slot_count + index]){
+                        continue;
+                    }
+                    uint slot = key_slots[index];
+                    bool live = false;
+                    switch (inst.op){
+                        case EOpcode::MATCH:
+                            break;
+                        case EOpcode::JUMP:
+                            live = live_slots[(pc + inst.x) * slot_count + index];
+                            break;
+                        case EOpcode::SPLIT:
+                            live = live_slots[(pc + inst.x) * slot_count + index] || live_slots[(pc + inst.y) * slot_count + index];
+                            break;
+                        case EOpcode::SAVE:
+                            live = inst.arg != slot && live_slots[(pc + 1) * slot_count + index];
+                            break;
+                        case EOpcode::BACKREF:
+                            live = slot / 2 == inst.arg || live_slots[(pc + 1) * slot_count + index];
+                            break;
+                        default:
+                            live = live_slots[(pc + 1) * slot_count + index];
+                            break;
+                    }
+                    if (live){
+                        live_slots[pc * slot_count + index] = true;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        needs_captures.assign(insts.size(), false);
+        for (size_t pc = 0; pc < insts.size(); ++pc){
+            for (size_t index = 0; index < slot_count; ++index){
+                if (live_slots[pc * slot_count + index]){
+                    needs_captures[pc] = true;
+                }
+            }
+        }
+    }
+
+    /**
+     * Check whether a thread reaching an instruction at a position still has to be explored, and remember it.
+     * @param pc The instruction reached.
+     * @param pos The position in the line.
+     * @return true if the thread has to be explored, false if an identical one already was.
+     */
+    bool BitState::should_visit(uint pc, uint pos){
+        if (use_bitmap && !needs_captures[pc]){
+            size_t bit = static_cast<size_t>(pos) * program->insts.size() + pc;
+            uint64_t mask = uint64_t{1} << (bit % 64);
+            if (visited[bit / 64] & mask){
+                return false;
+            }
+            visited[bit / 64] |= mask;
+            return true;
+        }
+        if (program->insts[pc].op != EOpcode::SPLIT){
+            // Straight-line code between two loops can only be reached again through one of them.
+            return true;
+        }
+        if (!memo_enabled){
+            // Most lines are settled long before the memo would pay for itself.
+            // Cycles through empty loops keep going until it is enabled, then stop at their second iteration.
+            if (++unmemoized_splits < memo_threshold){
+                return true;
+            }
+            memo_enabled = true;
+        }
+        return remember_captures(pc, pos);
+    }
+
+    /**
+     * Remember that a SPLIT instruction was reached at a position with the current captures.
+     * @param pc The instruction reached.
+     * @param pos The position in the line.
+     * @return true if this is the first time, false if it was already remembered.
+     */
+    bool BitState::remember_captures(uint pc, uint pos){
+        size_t key_size = 2 + key_slots.size();
+        if (2 * (memo_count + 1) > memo_table.size()){
+            grow_memo();
+        }
+
+        // Build the candidate key at the end of the key storage, and drop it again if it is already known.
+        size_t key_start = memo_keys.size();
+        memo_keys.push_back(pc);
+        memo_keys.push_back(pos);
+        // Dead slots are left out: two threads only differing by them have the same outcome.
+        size_t slot_count = key_slots.size();
+        for (size_t index = 0; index < slot_count; ++index){
+            memo_keys.push_back(live_slots[pc * slot_count + index] ? captures[key_slots[index]] : UNSET);
+        }
+        const uint* key = memo_keys.data() + key_start;
+
+        size_t mask = memo_table.size() - 1;
+        size_t bucket = priv::hash_memo_key(key, key_size) & mask;
+        while (memo_table[bucket] != 0){
+            const uint* other = memo_keys.data() + (memo_table[bucket] - 1) * key_size;
+            if (equal(key, key + key_size, other)){
+                memo_keys.resize(key_start);
+                return false;
+            }
+            bucket = (bucket + 1) & mask;
+        }
+        memo_table[bucket] = static_cast<uint>(memo_count + 1);
+        memo_count++;
+        return true;
+    }
+
+    /**
+     * Double the memo's table.
+     */
+    void BitState::grow_memo(){
+        size_t key_size = 2 + key_slots.size();
+        size_t new_size = memo_table.empty() ? 64 : 2 * memo_table.size();
+        memo_table.assign(new_size, 0);
+        size_t mask = new_size - 1;
+        for (size_t index = 0; index < memo_count; ++index){
+            size_t bucket = priv::hash_memo_key(memo_keys.data() + index * key_size, key_size) & mask;
+            while (memo_table[bucket] != 0){
+                bucket = (bucket + 1) & mask;
+            }
+            memo_table[bucket] = static_cast<uint>(index + 1);
+        }
+    }
+
+    /**
+     * Forget every state visited during the previous search.
+     * @param bitmap_words The amount of 64-bit words the visited bitmap needs for the new line, or 0 not to use it.
+     */
+    void BitState::reset(size_t bitmap_words){
+        use_bitmap = bitmap_words > 0;
+        visited.assign(bitmap_words, 0);
+        if (memo_count > 0){
+            fill(memo_table.begin(), memo_table.end(), 0);
+        }
+        memo_keys.clear();
+        memo_count = 0;
+        memo_enabled = false;
+        unmemoized_splits = 0;
+        fill(captures.begin(), captures.end(), UNSET);
+        jobs.clear();
+    }
+
+    /**
+     * Match the text captured by a group at a position of the line.
+     * @param group The group to match the text of.
+     * @param pos The position to match at. Moved past the text if it matched.
+     * @return true if the text was found at the position, false otherwise (including if the group is unset).
+     */
+    bool BitState::backref_matches(uint group, uint& pos) const{
+        uint start = captures[2 * group];
+        uint end = captures[2 * group + 1];
+        if (start == UNSET || end == UNSET || start > end){
+            return false;
+        }
+        uint length = end - start;
+        if (line.size() - pos < length || line.compare(pos, length, line.substr(start, length)) != 0){
+            return false;
+        }
+        pos += length;
+        return true;
+    }
+
+    /**
+     * Run the jobs on the stack until a match is found or the stack is empty.
+     * @return true if a thread reached a MATCH instruction, false otherwise.
+     */
+    bool BitState::run(){
+        const auto& insts = program->insts;
+        auto size = static_cast<uint>(line.size());
+        while (!jobs.empty()){
+            Job job = jobs.back();
+            jobs.pop_back();
+            if (job.restore){
+                captures[job.pc] = job.pos;
+                continue;
+            }
+
+            // Follow the thread until it dies, pushing the alternatives it leaves behind.
+            uint pc = job.pc;
+            uint pos = job.pos;
+            bool alive = true;
+            while (alive){
+                if (!should_visit(pc, pos)){
+                    break;
+                }
+
+                const Inst& inst = insts[pc];
+                switch (inst.op){
+                    case EOpcode::MATCH:
+                        return true;
+                    case EOpcode::JUMP:
+                        pc += inst.x;
+                        break;
+                    case EOpcode::SPLIT:
+                        jobs.push_back(Job{pc + inst.y, pos, false});
+                        pc += inst.x;
+                        break;
+                    case EOpcode::SAVE:
+                        // Undone when backtracking past this instruction.
+                        jobs.push_back(Job{inst.arg, captures[inst.arg], true});
+                        captures[inst.arg] = pos;
+                        pc++;
+                        break;
+                    case EOpcode::START_ANCHOR:
+                        alive = pos == 0;
+                        pc++;
+                        break;
+                    case EOpcode::END_ANCHOR:
+                        alive = pos == size;
+                        pc++;
+                        break;
+                    case EOpcode::BACKREF:
+                        alive = backref_matches(inst.arg, pos);
+                        pc++;
+                        break;
+                    default:
+                        alive = pos < size && program->accepts(inst, line[pos]);
+                        pos++;
+                        pc++;
+                        break;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool BitState::search(string_view input_line){
+        size_t bitmap_bits = program->insts.size() * (input_line.size() + 1);
+        size_t bitmap_words = (bitmap_bits + 63) / 64;
+        // Past the limit, the memo stands in for the bitmap: it only grows with the states visited.
+        reset(bitmap_words * sizeof(uint64_t) <= memory_limit ? bitmap_words : 0);
+        memo_threshold = bitmap_bits;
+        line = input_line;
+        // Every start position shares the memo: a state which failed from one start fails from the others too.
+        // Positions whose byte can't start a match are skipped.
+        for (
+            size_t start = program->next_start(input_line, 0);
+            start <= input_line.size();
+            start = program->next_start(input_line, start + 1)
+        ){
+            jobs.push_back(Job{0, static_cast<uint>(start), false});
+            if (run()){
+                return true;
+            }
+        }
+        return false;
+    }
+}
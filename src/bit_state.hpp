@@ -0,0 +1,94 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "program.hpp"
+
+namespace cpp_grep{
+    using ubyte = uint8_t;
+    using uint = uint32_t;
+
+    using std::string_view;
+    using std::vector;
+
+    /**
+     * @brief A memoizing backtracker running a compiled program, backreferences included.
+     *
+     * Threads are explored depth-first from an explicit stack instead of through recursion, and every
+     * (instruction, position) pair which was already explored is remembered so it is never explored twice.
+     * Where no capture can be read by a backreference before being overwritten, captures don't influence
+     * the outcome, so a bitmap is enough. Elsewhere, the captured spans which may still be read are part of
+     * what is remembered, and only loops (SPLIT instructions) are recorded, which is enough to bound the work
+     * done and to break empty loops. As this memo is costly, it is only enabled once the line took as many
+     * steps as there are (instruction, position) pairs.
+     *
+     * On lines whose bitmap would exceed the memory limit, the memo holds every state instead: SPLIT
+     * instructions are then remembered whether or not captures matter there. The memo is never dropped,
+     * so the work stays bounded by the amount of distinct states, and its size grows with the states
+     * actually visited rather than with the line.
+     *
+     * Backreferences to a group which didn't capture anything fail to match, as in Perl.
+     * The bitmap, stack and memo are kept from one search to the next.
+     */
+    class BitState{
+        /**
+         * @brief A pending unit of work on the backtracking stack.
+         */
+        struct Job{
+            uint pc;        // Instruction to resume at, or capture slot to restore.
+            uint pos;       // Position to resume at, or value to restore.
+            bool restore;   // Whether this job restores a capture slot instead of resuming a thread.
+        };
+
+        static constexpr uint UNSET = UINT32_MAX;
+
+        const Program* program;
+        size_t memory_limit;
+        string_view line;
+
+        vector<uint> key_slots;         // Capture slots read by the program's backreferences.
+        vector<bool> live_slots;        // Per instruction and key slot: whether a backreference may still read the slot.
+        vector<bool> needs_captures;    // Per instruction: whether any key slot is live there.
+
+        vector<uint64_t> visited;       // One bit per (position, instruction) pair, unless the line is too long for it.
+        bool use_bitmap{true};          // Whether visited is used during this search.
+        vector<uint> memo_keys;         // Remembered (instruction, position, captures) keys, back to back.
+        vector<uint> memo_table;        // Open-addressing table of key indices, plus one (0 is an empty bucket).
+        size_t memo_count{0};
+        size_t memo_threshold{0};       // How many unremembered SPLIT visits are allowed before enabling the memo.
+        size_t unmemoized_splits{0};
+        bool memo_enabled{false};
+
+        vector<uint> captures;
+        vector<Job> jobs;
+
+        [[nodiscard]] bool should_visit(uint pc, uint pos);
+        [[nodiscard]] bool remember_captures(uint pc, uint pos);
+        void grow_memo();
+        void reset(size_t bitmap_words);
+        [[nodiscard]] bool backref_matches(uint group, uint& pos) const;
+        [[nodiscard]] bool run();
+
+        public:
+            /**
+             * Prepare a backtracker for the given program.
+             * @param program The program to run. It must outlive the backtracker.
+             * @param memory_limit The maximum amount of memory (in bytes) the visited bitmap may take during a search.
+             * Lines needing more only use the memo.
+             */
+            BitState(const Program& program, size_t memory_limit);
+
+            /**
+             * @brief Check if the program matches anywhere in the given line.
+             * @param input_line The line to search. Positions in it must fit in 32 bits.
+             * @return true if the program matches the line, false otherwise.
+             */
+            [[nodiscard]] bool search(string_view input_line);
+    };
+}
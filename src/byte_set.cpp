@@ -0,0 +1,66 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <bit>
+
+#include "byte_set.hpp"
+
+namespace cpp_grep{
+    using std::popcount;
+
+    ByteSet ByteSet::from_char_group(const string& char_grp){
+        ByteSet ret;
+        size_t size = char_grp.size();
+        for (size_t i = 0; i < size; ++i){
+            auto first = static_cast<ubyte>(char_grp[i]);
+            if (i + 2 < size && char_grp[i + 1] == '-'){
+                auto last = static_cast<ubyte>(char_grp[i + 2]);
+                if (last < first){
+                    throw invalid_argument("Invalid range end in character group: " + char_grp.substr(i, 3));
+                }
+                ret.insert_range(first, last);
+                i += 2;
+                continue;
+            }
+            ret.insert(first);
+        }
+        return ret;
+    }
+
+    bool ByteSet::contains(ubyte chr) const{
+        return (words[chr >> 6] >> (chr & 63)) & 1;
+    }
+
+    bool ByteSet::contains(char chr) const{
+        return contains(static_cast<ubyte>(chr));
+    }
+
+    bool ByteSet::empty() const{
+        return (words[0] | words[1] | words[2] | words[3]) == 0;
+    }
+
+    uint32_t ByteSet::count() const{
+        uint32_t ret = 0;
+        for (uint64_t word: words){
+            ret += popcount(word);
+        }
+        return ret;
+    }
+
+    void ByteSet::insert(ubyte chr){
+        words[chr >> 6] |= uint64_t{1} << (chr & 63);
+    }
+
+    void ByteSet::insert_range(ubyte first, ubyte last){
+        for (uint32_t chr = first; chr <= last; ++chr){
+            insert(static_cast<ubyte>(chr));
+        }
+    }
+
+    void ByteSet::invert(){
+        for (uint64_t& word: words){
+            word = ~word;
+        }
+    }
+}
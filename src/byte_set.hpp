@@ -0,0 +1,51 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace cpp_grep{
+    using ubyte = uint8_t;
+
+    using std::array;
+    using std::invalid_argument;
+    using std::string;
+
+    /**
+     * @brief A set of bytes stored as a 256-bit bitmap.
+     *
+     * Membership is tested with a single shift and mask, whatever the amount of bytes in the set.
+     */
+    class ByteSet{
+        array<uint64_t, 4> words{};
+
+        public:
+            /**
+             * Generate an empty byte set.
+             */
+            ByteSet() = default;
+
+            /**
+             * @brief Build the set of bytes described by the inside of a bracket expression.
+             * Ranges such as "a-z" are expanded. A '-' at the start or the end of the group is a literal.
+             * @param char_grp The character group, without the brackets nor the leading '^' of negative groups.
+             * @return The set of bytes listed in the group.
+             * @throw invalid_argument if a range ends before it starts.
+             */
+            static ByteSet from_char_group(const string& char_grp);
+
+            [[nodiscard]] bool contains(ubyte chr) const;
+            [[nodiscard]] bool contains(char chr) const;
+            [[nodiscard]] bool empty() const;
+            [[nodiscard]] uint32_t count() const;
+
+            void insert(ubyte chr);
+            void insert_range(ubyte first, ubyte last);
+            void invert();
+    };
+}
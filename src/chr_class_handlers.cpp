@@ -6,10 +6,6 @@
 
 namespace cpp_grep{
     namespace priv{
-        namespace constants{
-            const string ASCII_CHRS = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
-        }
-
         /**
          * Check if a character is a digit or not.
          * @param chr The input character which the digit check will be performed on.
@@ -27,7 +23,9 @@ namespace cpp_grep{
          * @return true if the given character matches the word class, false otherwise.
          */
         bool is_word(char chr){
-            return is_digit(chr) || constants::ASCII_CHRS.contains(chr) || chr == '_';
+            // Setting bit 5 maps uppercase ASCII letters onto lowercase ones.
+            char lower = static_cast<char>(chr | 0x20);
+            return is_digit(chr) || ('a' <= lower && lower <= 'z') || chr == '_';
         }
     }
 
@@ -36,12 +34,8 @@ namespace cpp_grep{
      * @param input_line The input string the check has to be performed on.
      * @return true if any character in the string is a digit, false otherwise.
      */
-    bool match_digit_pattern(const string& input_line){
-        return any_of(
-            input_line.begin(),
-            input_line.end(),
-            priv::is_digit
-        );
+    bool match_digit_pattern(string_view input_line){
+        return priv::digit_scanner().any_of(input_line.data(), input_line.size());
     }
 
     /**
@@ -49,45 +43,33 @@ namespace cpp_grep{
      * @param input_line The input string the check has to be performed on.
      * @return true if any character in the string matches the regexp word class, false otherwise.
      */
-    bool match_word_pattern(const string& input_line){
-        return any_of(
-            input_line.begin(),
-            input_line.end(),
-            priv::is_word
-        );
+    bool match_word_pattern(string_view input_line){
+        return priv::word_scanner().any_of(input_line.data(), input_line.size());
     }
 
     /**
      * Match a positive character group, i.e. check if any character in the input string
      * is in the given character set.
      * @param input_line The input string the check should be performed on.
-     * @param chr_grp The character set used for the check.
+     * @param chr_grp The character set used for the check. Ranges such as "a-z" are supported.
      * @return true if any character in the string is contained in chr_grp, false otherwise.
      */
-    bool match_positive_character_grp(const string& input_line, const string& chr_grp){
-        return any_of(
-            input_line.begin(),
-            input_line.end(),
-            [chr_grp](char chr){  // Using a lambda here due to not knowing the character group in advance.
-                return chr_grp.contains(chr);
-            }
-        );
+    bool match_positive_character_grp(string_view input_line, const string& chr_grp){
+        ClassScanner scanner(ByteSet::from_char_group(chr_grp));
+        return scanner.any_of(input_line.data(), input_line.size());
     }
 
     /**
      * Match a positive character group, i.e. check if any character in the input string
      * is NOT in the given character set.
      * @param input_line The input string the check should be performed on.
-     * @param chr_grp The character set used for the check.
+     * @param chr_grp The character set used for the check. Ranges such as "a-z" are supported.
      * @return true if at least one character in the string isn't in in chr_grp, false otherwise.
      */
-    bool match_negative_character_grp(const string& input_line, const string& chr_grp){
-        return any_of(
-            input_line.begin(),
-            input_line.end(),
-            [chr_grp](char chr){  // Using a lambda here due to not knowing the character group in advance.
-                return !chr_grp.contains(chr);
-            }
-        );
+    bool match_negative_character_grp(string_view input_line, const string& chr_grp){
+        ByteSet char_set = ByteSet::from_char_group(chr_grp);
+        char_set.invert();
+        ClassScanner scanner(char_set);
+        return scanner.any_of(input_line.data(), input_line.size());
     }
 }
@@ -6,19 +6,24 @@
 
 #include <algorithm>
 #include <string>
+#include <string_view>
+
+#include "byte_set.hpp"
+#include "class_scan.hpp"
 
 namespace cpp_grep{
     using std::any_of;
     using std::all_of;
     using std::string;
+    using std::string_view;
 
     namespace priv{
         bool is_digit(char chr);
         bool is_word(char chr);
     }
 
-    bool match_digit_pattern(const string& input_line);
-    bool match_word_pattern(const string& input_line);
-    bool match_positive_character_grp(const string& input_line, const string& chr_grp);
-    bool match_negative_character_grp(const string& input_line, const string& chr_grp);
+    bool match_digit_pattern(string_view input_line);
+    bool match_word_pattern(string_view input_line);
+    bool match_positive_character_grp(string_view input_line, const string& chr_grp);
+    bool match_negative_character_grp(string_view input_line, const string& chr_grp);
 }
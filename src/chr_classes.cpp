@@ -3,9 +3,7 @@
 //
 
 #include "chr_classes.hpp"
-#include <iostream>
-
-using std::cerr;
+#include "trace.hpp"
 
 namespace cpp_grep{
     namespace priv{
@@ -24,6 +22,19 @@ namespace cpp_grep{
         }
     }
 
+    /**
+     * Initialise a character group.
+     * @param char_grp The character group, ranges included.
+     * @param positive_match Whether this group is a positive group or a negative group.
+     * @throw invalid_argument if the group contains an invalid range.
+     */
+    GroupCharClass::GroupCharClass(const string& char_grp, bool positive_match)
+    : char_group(char_grp), positive_match(positive_match), char_set(ByteSet::from_char_group(char_grp)){
+        if (!positive_match){
+            char_set.invert();
+        }
+    }
+
     OrCharClass::OrCharClass(const vector<RegexPatternPortion>& subpattern1, const vector<RegexPatternPortion>& subpattern2)
     : subpattern1(subpattern1), subpattern2(subpattern2){}
 
@@ -407,48 +418,60 @@ namespace cpp_grep{
             // This should NEVER happen, but in case it does...
             throw logic_error("Cannot retrieve a literal from a non-literal pattern portion object");
         }
-        return ((LiteralCharClass*)cls_info.get())->literal;
+        return static_cast<const LiteralCharClass*>(cls_info.get())->literal;
     }
     // endregion
 
     // region RegexPatternPortion : Getters (group char. class)
-    string RegexPatternPortion::get_char_grp() const{
+    const string& RegexPatternPortion::get_char_grp() const{
         if (char_cls != ECharClass::CHAR_GROUP && char_cls != ECharClass::CHAR_GROUP_MOST_ONE && char_cls != ECharClass::CHAR_GROUP_LEAST_ONE){
             throw logic_error("Cannot retrieve a char group string from a non-char. group pattern portion object");
         }
-        return ((GroupCharClass*)cls_info.get())->char_group;
+        return static_cast<const GroupCharClass*>(cls_info.get())->char_group;
+    }
+
+    /**
+     * Get the set of bytes matched by this group.
+     * Negative groups are already inverted, so a byte matches if and only if it is in the set.
+     * @return The set of bytes matched by this group.
+     */
+    const ByteSet& RegexPatternPortion::get_char_set() const{
+        if (char_cls != ECharClass::CHAR_GROUP && char_cls != ECharClass::CHAR_GROUP_MOST_ONE && char_cls != ECharClass::CHAR_GROUP_LEAST_ONE){
+            throw logic_error("Cannot retrieve a char group set from a non-char. group pattern portion object");
+        }
+        return static_cast<const GroupCharClass*>(cls_info.get())->char_set;
     }
 
     bool RegexPatternPortion::is_positive_grp() const{
         if (char_cls != ECharClass::CHAR_GROUP && char_cls != ECharClass::CHAR_GROUP_MOST_ONE && char_cls != ECharClass::CHAR_GROUP_LEAST_ONE){
             throw logic_error("Cannot retrieve a char group string from a non-char. group pattern portion object");
         }
-        return ((GroupCharClass*)cls_info.get())->positive_match;
+        return static_cast<const GroupCharClass*>(cls_info.get())->positive_match;
     }
     // endregion
 
     // region RegexPatternPortion: Getters (or char. class)
-    vector<RegexPatternPortion> RegexPatternPortion::get_subpattern1() const{
+    const vector<RegexPatternPortion>& RegexPatternPortion::get_subpattern1() const{
         if (char_cls != ECharClass::OR){
             throw logic_error("Cannot retrieve a subpattern from a non-or pattern portion object");
         }
-        return ((OrCharClass*)cls_info.get())->subpattern1;
+        return static_cast<const OrCharClass*>(cls_info.get())->subpattern1;
     }
 
-    vector<RegexPatternPortion> RegexPatternPortion::get_subpattern2() const{
+    const vector<RegexPatternPortion>& RegexPatternPortion::get_subpattern2() const{
         if (char_cls != ECharClass::OR){
             throw logic_error("Cannot retrieve a subpattern from a non-or pattern portion object");
         }
-        return ((OrCharClass*)cls_info.get())->subpattern2;
+        return static_cast<const OrCharClass*>(cls_info.get())->subpattern2;
     }
     // endregion
 
     // region RegexPatternPortion: Getters (pattern char. class)
-    vector<RegexPatternPortion> RegexPatternPortion::get_subpattern() const{
+    const vector<RegexPatternPortion>& RegexPatternPortion::get_subpattern() const{
         if (char_cls != ECharClass::PATTERN && char_cls != ECharClass::PATTERN_LEAST_ONE && char_cls != ECharClass::PATTERN_MOST_ONE){
             throw logic_error("Cannot retrieve a subpattern from a non-subpattern portion object");
         }
-        return ((PatternCharClass*)cls_info.get())->subpattern;
+        return static_cast<const PatternCharClass*>(cls_info.get())->subpattern;
     }
     // endregion
 
@@ -457,7 +480,7 @@ namespace cpp_grep{
         if (char_cls != ECharClass::BACKREFERENCE && char_cls != ECharClass::BACKREF_LEAST_ONE && char_cls != ECharClass::BACKREF_MOST_ONE){
             throw logic_error("Cannot retrieve a backreference index from a non-backreference portion object");
         }
-        return ((BackRefCharClass*)cls_info.get())->backref;
+        return static_cast<const BackRefCharClass*>(cls_info.get())->backref;
     }
     // endregion
 
@@ -467,7 +490,7 @@ namespace cpp_grep{
         uint idx = 0;
         size_t orig_size = input.size();
         while (!temp.empty()){
-            cerr << temp << "\n";
+            CPP_GREP_TRACE(VERBOSE, "Remaining pattern: ", temp);
             if (temp.size() == orig_size && temp[0] == '^'){
                 ret.emplace_back(
                     ECharClass::START_ANCHOR
@@ -672,7 +695,7 @@ namespace cpp_grep{
                     flg = 0;
                 }
                 auto extracted_subpattern_string = temp.substr(1, index - 1);
-                cerr << "Extracted subpattern: " << extracted_subpattern_string << "\n";
+                CPP_GREP_TRACE(VERBOSE, "Extracted subpattern: ", extracted_subpattern_string);
                 caught_grp_count++;  // Create a new string to memorise during pattern matching.
                 auto extracted_subpattern = extract_patterns(extracted_subpattern_string, caught_grp_count);
                 ret.emplace_back(extracted_subpattern, flg);
@@ -681,14 +704,14 @@ namespace cpp_grep{
                     0,
                     index + 1 + (flg > 0 ? 1 : 0)
                 );
-                cerr << "After erasure: " << temp << "\n";
+                CPP_GREP_TRACE(VERBOSE, "After erasure: ", temp);
             }
             else if (temp.contains('|') && !temp.contains('(')){
                 string::size_type sep_pos = temp.find('|');
                 string subpattern_a = temp.substr(0, sep_pos);
                 string subpattern_b = temp.substr(sep_pos + 1);
-                cerr << "Subpattern A: " << subpattern_a << "\n";
-                cerr << "Subpattern B: " << subpattern_b << "\n";
+                CPP_GREP_TRACE(VERBOSE, "Subpattern A: ", subpattern_a);
+                CPP_GREP_TRACE(VERBOSE, "Subpattern B: ", subpattern_b);
                 auto extracted_spa = extract_patterns(subpattern_a, caught_grp_count);
                 auto extracted_spb = extract_patterns(subpattern_b, caught_grp_count);
                 ret.emplace_back(extracted_spa, extracted_spb);
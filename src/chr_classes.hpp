@@ -13,6 +13,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include "byte_set.hpp"
 #include "chr_class_handlers.hpp"
 
 namespace cpp_grep{
@@ -84,9 +85,9 @@ namespace cpp_grep{
     struct GroupCharClass: public CharClass{
         string char_group;       // The character group.
         bool positive_match{false};    // Positive/negative character group.
+        ByteSet char_set;        // Every byte this group matches, ranges expanded and negation applied.
 
-        GroupCharClass(const string& char_grp, bool positive_match)
-        : char_group(char_grp), positive_match(positive_match){}
+        GroupCharClass(const string& char_grp, bool positive_match);
     };
 
     struct BackRefCharClass: public CharClass{
@@ -135,15 +136,16 @@ namespace cpp_grep{
             [[nodiscard]] char get_literal() const;
 
             // GETTERS (GROUP CHAR. CLASS)
-            [[nodiscard]] string get_char_grp() const;
+            [[nodiscard]] const string& get_char_grp() const;
+            [[nodiscard]] const ByteSet& get_char_set() const;
             [[nodiscard]] bool is_positive_grp() const;
 
             // GETTERS (OR CHAR. CLASS)
-            [[nodiscard]] vector<RegexPatternPortion> get_subpattern1() const;
-            [[nodiscard]] vector<RegexPatternPortion> get_subpattern2() const;
+            [[nodiscard]] const vector<RegexPatternPortion>& get_subpattern1() const;
+            [[nodiscard]] const vector<RegexPatternPortion>& get_subpattern2() const;
 
             // GETTERS (PATTERN CHAR. CLASS)
-            [[nodiscard]] vector<RegexPatternPortion> get_subpattern() const;
+            [[nodiscard]] const vector<RegexPatternPortion>& get_subpattern() const;
 
             // GETTERS (BACKREF CHAR. CLASS)
             [[nodiscard]] ubyte get_backref_index() const;
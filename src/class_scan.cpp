@@ -0,0 +1,225 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <bit>
+#include <cstring>
+
+#include "class_scan.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define CPP_GREP_X86_SIMD 1
+    #include <immintrin.h>
+#endif
+
+namespace cpp_grep{
+    using std::countr_zero;
+    using std::memchr;
+
+    namespace priv{
+        bool cpu_has_avx2(){
+            #ifdef CPP_GREP_X86_SIMD
+            static const bool has_avx2 = __builtin_cpu_supports("avx2");
+            return has_avx2;
+            #else
+            return false;
+            #endif
+        }
+
+        bool cpu_has_sse2(){
+            #ifdef CPP_GREP_X86_SIMD
+            static const bool has_sse2 = __builtin_cpu_supports("sse2");
+            return has_sse2;
+            #else
+            return false;
+            #endif
+        }
+
+        const ClassScanner& digit_scanner(){
+            static const ClassScanner scanner(ByteSet::from_char_group("0-9"));
+            return scanner;
+        }
+
+        const ClassScanner& word_scanner(){
+            static const ClassScanner scanner(ByteSet::from_char_group("0-9A-Za-z_"));
+            return scanner;
+        }
+    }
+
+    ClassScanner::ClassScanner(const ByteSet& members): members(members){
+        // Split the class into ranges, for the SSE2 kernel.
+        size_t ranges = 0;
+        for (uint32_t chr = 0; chr < 256; ++chr){
+            if (!members.contains(static_cast<ubyte>(chr))){
+                continue;
+            }
+            uint32_t last = chr;
+            while (last + 1 < 256 && members.contains(static_cast<ubyte>(last + 1))){
+                last++;
+            }
+            if (ranges < MAX_SSE2_RANGES){
+                range_starts[ranges] = static_cast<ubyte>(chr);
+                range_lengths[ranges] = static_cast<ubyte>(last - chr);
+            }
+            ranges++;
+            chr = last;
+        }
+        range_count = ranges;
+        single_member = members.count() == 1;
+
+        // Build the nibble tables, for the AVX2 kernel.
+        for (uint32_t chr = 0; chr < 256; ++chr){
+            if (!members.contains(static_cast<ubyte>(chr))){
+                continue;
+            }
+            uint32_t low = chr & 0x0F;
+            uint32_t high = chr >> 4;
+            if (high < 8){
+                low_rows[low] |= static_cast<ubyte>(1u << high);
+            }
+            else{
+                high_rows[low] |= static_cast<ubyte>(1u << (high - 8));
+            }
+        }
+
+        if (priv::cpu_has_avx2()){
+            kernel = EKernel::AVX2_NIBBLES;
+        }
+        else if (priv::cpu_has_sse2() && range_count <= MAX_SSE2_RANGES){
+            kernel = EKernel::SSE2_RANGES;
+        }
+        else{
+            kernel = EKernel::SCALAR;
+        }
+    }
+
+    /**
+     * Find the first byte which is in the class, one byte at a time.
+     * @param data The start of the buffer.
+     * @param size The size of the buffer.
+     * @return The index of the byte found, or size if there isn't any.
+     */
+    size_t ClassScanner::find_scalar(const char* data, size_t size) const{
+        for (size_t i = 0; i < size; ++i){
+            if (members.contains(data[i])){
+                return i;
+            }
+        }
+        return size;
+    }
+
+    #ifdef CPP_GREP_X86_SIMD
+    /**
+     * Find the first byte which is in the class, 16 bytes at a time.
+     * Each byte is tested against every range with a wrapping subtraction and a saturated one.
+     * @param data The start of the buffer.
+     * @param size The size of the buffer.
+     * @return The index of the byte found, or size if there isn't any.
+     */
+    __attribute__((target("sse2")))
+    size_t ClassScanner::find_sse2(const char* data, size_t size) const{
+        const __m128i zero = _mm_setzero_si128();
+        __m128i starts[MAX_SSE2_RANGES];
+        __m128i lengths[MAX_SSE2_RANGES];
+        for (size_t r = 0; r < range_count; ++r){
+            starts[r] = _mm_set1_epi8(static_cast<char>(range_starts[r]));
+            lengths[r] = _mm_set1_epi8(static_cast<char>(range_lengths[r]));
+        }
+
+        size_t i = 0;
+        for (; i + 16 <= size; i += 16){
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i hits = zero;
+            for (size_t r = 0; r < range_count; ++r){
+                // (chr - start) <= length, as unsigned bytes.
+                __m128i offset = _mm_sub_epi8(chunk, starts[r]);
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(_mm_subs_epu8(offset, lengths[r]), zero));
+            }
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+            if (mask != 0){
+                return i + countr_zero(mask);
+            }
+        }
+        return i + find_scalar(data + i, size - i);
+    }
+
+    /**
+     * Find the first byte which is in the class, 32 bytes at a time.
+     * The low nibble of each byte selects a row of the class bitmap, the high nibble a bit in that row.
+     * @param data The start of the buffer.
+     * @param size The size of the buffer.
+     * @return The index of the byte found, or size if there isn't any.
+     */
+    __attribute__((target("avx2")))
+    size_t ClassScanner::find_avx2(const char* data, size_t size) const{
+        const __m256i low_table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(low_rows.data())));
+        const __m256i high_table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(high_rows.data())));
+        const __m256i bit_table = _mm256_setr_epi8(
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+            1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128
+        );
+        const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32){
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            __m256i low = _mm256_and_si256(chunk, nibble_mask);
+            __m256i high = _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble_mask);
+            // Bytes >= 0x80 have their top bit set, which selects the second table.
+            __m256i rows = _mm256_blendv_epi8(
+                _mm256_shuffle_epi8(low_table, low),
+                _mm256_shuffle_epi8(high_table, low),
+                chunk
+            );
+            __m256i bits = _mm256_shuffle_epi8(bit_table, high);
+            __m256i hits = _mm256_cmpeq_epi8(_mm256_and_si256(rows, bits), bits);
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+            if (mask != 0){
+                return i + countr_zero(mask);
+            }
+        }
+        return i + find_scalar(data + i, size - i);
+    }
+    #else
+    size_t ClassScanner::find_sse2(const char* data, size_t size) const{
+        return find_scalar(data, size);
+    }
+
+    size_t ClassScanner::find_avx2(const char* data, size_t size) const{
+        return find_scalar(data, size);
+    }
+    #endif
+
+    /**
+     * Find the first byte which is in the class with the kernel picked for this scanner.
+     * @param data The start of the buffer.
+     * @param size The size of the buffer.
+     * @return The index of the byte found, or size if there isn't any.
+     */
+    size_t ClassScanner::find(const char* data, size_t size) const{
+        switch (kernel){
+            case EKernel::AVX2_NIBBLES:
+                return find_avx2(data, size);
+            case EKernel::SSE2_RANGES:
+                return find_sse2(data, size);
+            default:
+                return find_scalar(data, size);
+        }
+    }
+
+    size_t ClassScanner::find_first(const char* data, size_t size) const{
+        if (single_member){
+            const void* found = memchr(data, range_starts[0], size);
+            return found == nullptr ? size : static_cast<const char*>(found) - data;
+        }
+        return find(data, size);
+    }
+
+    bool ClassScanner::any_of(const char* data, size_t size) const{
+        return find(data, size) < size;
+    }
+
+    const ByteSet& ClassScanner::get_members() const{
+        return members;
+    }
+}
@@ -0,0 +1,113 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "byte_set.hpp"
+
+namespace cpp_grep{
+    using ubyte = uint8_t;
+
+    using std::array;
+
+    /**
+     * @brief Scans buffers for bytes in a character class, 16 or 32 bytes at a time.
+     *
+     * The kernel is picked once, when the scanner is built, based on the CPU and the class:
+     * - AVX2: any class, through two nibble lookup tables (32 bytes per step);
+     * - SSE2: classes made of at most MAX_SSE2_RANGES byte ranges (16 bytes per step);
+     * - scalar: everything else, one byte at a time.
+     * Looking for the only member of a single-byte class is left to memchr.
+     */
+    class ClassScanner{
+        public:
+            static constexpr size_t MAX_SSE2_RANGES = 4;
+
+        private:
+            // The kernel used by this scanner.
+            enum class EKernel: ubyte{
+                SCALAR,
+                SSE2_RANGES,
+                AVX2_NIBBLES,
+            };
+
+            ByteSet members;
+            EKernel kernel{EKernel::SCALAR};
+
+            // SSE2 kernel: the class as a list of inclusive byte ranges.
+            array<ubyte, MAX_SSE2_RANGES> range_starts{};
+            array<ubyte, MAX_SSE2_RANGES> range_lengths{};  // Last byte minus first byte.
+            size_t range_count{0};
+            bool single_member{false};  // Whether the class holds a single byte, which is then range_starts[0].
+
+            // AVX2 kernel: for each low nibble, which high nibbles (0-7 and 8-15) are in the class.
+            array<ubyte, 16> low_rows{};
+            array<ubyte, 16> high_rows{};
+
+            [[nodiscard]] size_t find_scalar(const char* data, size_t size) const;
+            [[nodiscard]] size_t find_sse2(const char* data, size_t size) const;
+            [[nodiscard]] size_t find_avx2(const char* data, size_t size) const;
+            [[nodiscard]] size_t find(const char* data, size_t size) const;
+
+        public:
+            /**
+             * Generate a scanner matching nothing.
+             */
+            ClassScanner() = default;
+
+            /**
+             * Build a scanner for the given character class.
+             * @param members The bytes in the class.
+             */
+            explicit ClassScanner(const ByteSet& members);
+
+            /**
+             * @brief Find the first byte of a buffer which is in the class.
+             * @param data The start of the buffer.
+             * @param size The size of the buffer.
+             * @return The index of the first byte in the class, or size if there isn't any.
+             */
+            [[nodiscard]] size_t find_first(const char* data, size_t size) const;
+
+            /**
+             * @brief Check if any byte of a buffer is in the class.
+             * @param data The start of the buffer.
+             * @param size The size of the buffer.
+             * @return true if a byte of the buffer is in the class, false otherwise.
+             */
+            [[nodiscard]] bool any_of(const char* data, size_t size) const;
+
+            [[nodiscard]] const ByteSet& get_members() const;
+    };
+
+    namespace priv{
+        /**
+         * Check once whether the CPU running the program supports AVX2.
+         * @return true if AVX2 kernels can be used, false otherwise.
+         */
+        bool cpu_has_avx2();
+
+        /**
+         * Check whether SSE2 kernels can be used.
+         * @return true on x86 CPUs, false otherwise.
+         */
+        bool cpu_has_sse2();
+
+        /**
+         * Get the scanner for the digit class (\d).
+         * @return A scanner matching '0' to '9'.
+         */
+        const ClassScanner& digit_scanner();
+
+        /**
+         * Get the scanner for the word class (\w).
+         * @return A scanner matching ASCII letters, digits and the underscore.
+         */
+        const ClassScanner& word_scanner();
+    }
+}
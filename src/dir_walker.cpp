@@ -0,0 +1,280 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "dir_walker.hpp"
+
+namespace cpp_grep{
+    using std::array;
+    using std::make_shared;
+    using std::memory_order_relaxed;
+    using std::pair;
+    using std::reverse;
+    using std::strcmp;
+    using std::strerror;
+    using std::vector;
+
+    namespace priv{
+        constexpr size_t DIRENT_BUFFER_SIZE = 32 * 1024;
+
+        // The record layout returned by getdents64.
+        struct LinuxDirent64{
+            ino64_t d_ino;
+            off64_t d_off;
+            unsigned short d_reclen;
+            unsigned char d_type;
+            char d_name[1];
+        };
+
+        // The kinds of directory entries a walk cares about.
+        enum class EEntryKind: ubyte{
+            REGULAR,
+            DIRECTORY,
+            OTHER,
+        };
+
+        // A directory found during a walk, not opened yet.
+        using PendingDir = pair<shared_ptr<WalkedDir>, string>;
+
+        /**
+         * Check whether a walk was asked to end early.
+         * @param stop The walk's stop flag, or nullptr if it can't be stopped.
+         * @return true if the flag is set, false otherwise.
+         */
+        bool should_stop(const atomic<bool>* stop){
+            return stop != nullptr && stop->load(memory_order_relaxed);
+        }
+
+        /**
+         * Find out what kind of entry a directory entry is.
+         * @param dir_fd The directory the entry is in.
+         * @param name The entry's name.
+         * @param d_type The type reported by getdents64.
+         * @return The entry's kind.
+         */
+        EEntryKind entry_kind(int dir_fd, const char* name, unsigned char d_type){
+            switch (d_type){
+                case DT_REG:
+                    return EEntryKind::REGULAR;
+                case DT_DIR:
+                    return EEntryKind::DIRECTORY;
+                case DT_UNKNOWN:
+                {
+                    struct stat info{};
+                    if (fstatat(dir_fd, name, &info, AT_SYMLINK_NOFOLLOW) != 0){
+                        return EEntryKind::OTHER;
+                    }
+                    if (S_ISREG(info.st_mode)){
+                        return EEntryKind::REGULAR;
+                    }
+                    return S_ISDIR(info.st_mode) ? EEntryKind::DIRECTORY : EEntryKind::OTHER;
+                }
+                case DT_LNK:
+                {
+                    struct stat info{};
+                    if (fstatat(dir_fd, name, &info, 0) == 0 && S_ISREG(info.st_mode)){
+                        return EEntryKind::REGULAR;
+                    }
+                    return EEntryKind::OTHER;
+                }
+                default:
+                    return EEntryKind::OTHER;
+            }
+        }
+
+        /**
+         * Call a function on every entry of a directory, "." and ".." excluded.
+         * @param dir_fd The directory to read.
+         * @param on_entry The function to call, given each entry's name and kind.
+         */
+        template<typename EntryFunc> void read_entries(int dir_fd, EntryFunc on_entry){
+            vector<char> buffer(DIRENT_BUFFER_SIZE);
+            while (true){
+                long count = syscall(SYS_getdents64, dir_fd, buffer.data(), buffer.size());
+                if (count <= 0){
+                    if (count < 0 && errno == EINTR){
+                        continue;
+                    }
+                    return;
+                }
+                for (long offset = 0; offset < count;){
+                    const auto* entry = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+                    offset += entry->d_reclen;
+                    const char* name = entry->d_name;
+                    if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0){
+                        continue;
+                    }
+                    on_entry(name, entry_kind(dir_fd, name, entry->d_type));
+                }
+            }
+        }
+
+        /**
+         * Open the root of a walk.
+         * @param root The root directory's path.
+         * @return The open directory.
+         * @throw runtime_error if the directory can't be opened.
+         */
+        shared_ptr<WalkedDir> open_root(const string& root){
+            int fd = open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0){
+                throw runtime_error("Cannot open directory " + root + ": " + strerror(errno));
+            }
+            return make_shared<WalkedDir>(fd, root);
+        }
+
+        /**
+         * Open a directory found during a walk.
+         * @param pending The directory's parent and name.
+         * @return The open directory, or nullptr if it can't be opened.
+         */
+        shared_ptr<WalkedDir> open_pending(const PendingDir& pending){
+            int fd = openat(pending.first->get_fd(), pending.second.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0){
+                return nullptr;
+            }
+            return make_shared<WalkedDir>(fd, pending.first->join(pending.second.c_str()));
+        }
+
+        void walk_pending_parallel(PendingDir pending, WorkStealingPool& pool, const WalkFileVisitor& visit_file, const atomic<bool>* stop);  // NOLINT
+
+        /**
+         * Read a directory on a pool worker, queueing a task for each of its files and subdirectories.
+         * @param dir The directory to read.
+         * @param pool The pool to queue tasks on.
+         * @param visit_file The function called for each regular file.
+         * @param stop The walk's stop flag, or nullptr.
+         */
+        void walk_dir_parallel(const shared_ptr<WalkedDir>& dir, WorkStealingPool& pool, const WalkFileVisitor& visit_file, const atomic<bool>* stop){  // NOLINT
+            read_entries(
+                dir->get_fd(),
+                [&dir, &pool, &visit_file, stop](const char* name, EEntryKind kind){
+                    if (should_stop(stop)){
+                        return;
+                    }
+                    if (kind == EEntryKind::REGULAR){
+                        pool.submit(
+                            [dir, file_name = string(name), &visit_file, stop](uint worker){
+                                if (!should_stop(stop)){
+                                    visit_file(*dir, file_name.c_str(), worker);
+                                }
+                            }
+                        );
+                    }
+                    else if (kind == EEntryKind::DIRECTORY){
+                        pool.submit(
+                            [pending = PendingDir(dir, name), &pool, &visit_file, stop](uint) mutable{
+                                walk_pending_parallel(std::move(pending), pool, visit_file, stop);
+                            }
+                        );
+                    }
+                }
+            );
+        }
+
+        /**
+         * Open and read a directory found during a parallel walk.
+         * @param pending The directory's parent and name.
+         * @param pool The pool to queue tasks on.
+         * @param visit_file The function called for each regular file.
+         * @param stop The walk's stop flag, or nullptr.
+         */
+        void walk_pending_parallel(PendingDir pending, WorkStealingPool& pool, const WalkFileVisitor& visit_file, const atomic<bool>* stop){  // NOLINT
+            if (should_stop(stop)){
+                return;
+            }
+            shared_ptr<WalkedDir> dir = open_pending(pending);
+            // The parent only has to stay open until its subdirectory is.
+            pending.first.reset();
+            if (dir != nullptr){
+                walk_dir_parallel(dir, pool, visit_file, stop);
+            }
+        }
+    }
+
+    WalkedDir::WalkedDir(int fd, string path): fd(fd), path(std::move(path)){
+    }
+
+    WalkedDir::~WalkedDir(){
+        close(fd);
+    }
+
+    int WalkedDir::get_fd() const{
+        return fd;
+    }
+
+    const string& WalkedDir::get_path() const{
+        return path;
+    }
+
+    string WalkedDir::join(const char* name) const{
+        string joined = path;
+        if (!joined.ends_with('/')){
+            joined += '/';
+        }
+        joined += name;
+        return joined;
+    }
+
+    void walk_directory(const string& root, const WalkFileVisitor& visit_file, const atomic<bool>* stop){
+        shared_ptr<WalkedDir> dir = priv::open_root(root);
+        // Directories left to read. Only the parents of pending directories are kept open.
+        vector<priv::PendingDir> pending_dirs;
+        vector<priv::PendingDir> subdirs;
+        while (true){
+            subdirs.clear();
+            priv::read_entries(
+                dir->get_fd(),
+                [&dir, &subdirs, &visit_file, stop](const char* name, priv::EEntryKind kind){
+                    if (priv::should_stop(stop)){
+                        return;
+                    }
+                    if (kind == priv::EEntryKind::REGULAR){
+                        visit_file(*dir, name, 0);
+                    }
+                    else if (kind == priv::EEntryKind::DIRECTORY){
+                        subdirs.emplace_back(dir, name);
+                    }
+                }
+            );
+            // Visit subdirectories depth first, in the order they were listed.
+            reverse(subdirs.begin(), subdirs.end());
+            for (auto& subdir: subdirs){
+                pending_dirs.push_back(std::move(subdir));
+            }
+            dir.reset();
+
+            while (dir == nullptr){
+                if (pending_dirs.empty() || priv::should_stop(stop)){
+                    return;
+                }
+                dir = priv::open_pending(pending_dirs.back());
+                pending_dirs.pop_back();
+            }
+        }
+    }
+
+    void walk_directory_parallel(const string& root, WorkStealingPool& pool, const WalkFileVisitor& visit_file, const atomic<bool>* stop){
+        shared_ptr<WalkedDir> dir = priv::open_root(root);
+        pool.submit(
+            [dir, &pool, &visit_file, stop](uint){
+                priv::walk_dir_parallel(dir, pool, visit_file, stop);
+            }
+        );
+        dir.reset();
+        pool.wait();
+    }
+}
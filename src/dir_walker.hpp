@@ -0,0 +1,87 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "thread_pool.hpp"
+
+namespace cpp_grep{
+    using ubyte = uint8_t;
+
+    using std::atomic;
+    using std::function;
+    using std::runtime_error;
+    using std::shared_ptr;
+    using std::string;
+
+    /**
+     * @brief A directory opened during a walk.
+     * Entries are opened relative to its file descriptor, which is closed along with the object.
+     */
+    class WalkedDir{
+        int fd;
+        string path;
+
+        public:
+            /**
+             * Take ownership of an open directory.
+             * @param fd The directory's file descriptor.
+             * @param path The directory's path, as shown to the user.
+             */
+            WalkedDir(int fd, string path);
+
+            ~WalkedDir();
+
+            WalkedDir(const WalkedDir&) = delete;
+            WalkedDir& operator=(const WalkedDir&) = delete;
+
+            [[nodiscard]] int get_fd() const;
+            [[nodiscard]] const string& get_path() const;
+
+            /**
+             * Get the path of an entry of this directory.
+             * @param name The entry's name.
+             * @return The directory's path followed by the name.
+             */
+            [[nodiscard]] string join(const char* name) const;
+    };
+
+    // Called for every regular file found: the directory it is in, its name, and the index of the worker thread finding it.
+    using WalkFileVisitor = function<void(const WalkedDir&, const char*, uint)>;
+
+    /**
+     * @brief Walk a directory tree on the calling thread.
+     *
+     * Directories are read with getdents64 and opened relative to their parent with openat.
+     * The entry types reported by the kernel are used to skip non-regular files, so entries are only
+     * stat'ed if the filesystem doesn't report their type, or if they are symbolic links
+     * (links to regular files are searched, links to directories aren't followed).
+     * Each directory's files are visited before its subdirectories, in the order the kernel lists them.
+     * @param root The directory to walk.
+     * @param visit_file The function called for each regular file, with 0 as its worker index.
+     * @param stop If given, the walk ends early once it is set: no more directories are read, and no more files visited.
+     * @throw runtime_error if the root directory can't be opened.
+     */
+    void walk_directory(const string& root, const WalkFileVisitor& visit_file, const atomic<bool>* stop = nullptr);
+
+    /**
+     * @brief Walk a directory tree on a thread pool.
+     *
+     * Works like walk_directory, except that directories are read concurrently, and every file found
+     * is visited in its own pool task as soon as it is found. Returns once the whole tree was visited.
+     * @param root The directory to walk.
+     * @param pool The pool to run on.
+     * @param visit_file The function called for each regular file, from the worker thread visiting it.
+     * @param stop If given, the walk ends early once it is set (see walk_directory).
+     * @throw runtime_error if the root directory can't be opened.
+     */
+    void walk_directory_parallel(const string& root, WorkStealingPool& pool, const WalkFileVisitor& visit_file, const atomic<bool>* stop = nullptr);
+}
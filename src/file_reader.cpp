@@ -0,0 +1,166 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "file_reader.hpp"
+
+namespace cpp_grep{
+    namespace priv{
+        constexpr size_t STREAM_READ_CHUNK = 64 * 1024;
+
+        /**
+         * Closes a file descriptor when going out of scope.
+         */
+        struct FdCloser{
+            int fd;
+
+            ~FdCloser(){
+                close(fd);
+            }
+        };
+
+        /**
+         * Read from a file descriptor until the given amount of bytes was read, retrying on short reads.
+         * @param fd The file descriptor to read from.
+         * @param data The buffer to fill.
+         * @param size The amount of bytes to read.
+         * @return The amount of bytes read, which is less than size if the end of the file was reached, or -1 on error.
+         */
+        ssize_t read_fully(int fd, char* data, size_t size){
+            size_t total = 0;
+            while (total < size){
+                ssize_t count = read(fd, data + total, size - total);
+                if (count < 0){
+                    if (errno == EINTR){
+                        continue;
+                    }
+                    return -1;
+                }
+                if (count == 0){
+                    break;
+                }
+                total += static_cast<size_t>(count);
+            }
+            return static_cast<ssize_t>(total);
+        }
+    }
+
+    FileReader::FileReader(size_t mmap_threshold): mmap_threshold(mmap_threshold){
+    }
+
+    FileReader::~FileReader(){
+        unmap();
+    }
+
+    /**
+     * Release the current mapping, if any.
+     */
+    void FileReader::unmap(){
+        if (mapping != nullptr){
+            munmap(mapping, mapping_size);
+            mapping = nullptr;
+            mapping_size = 0;
+        }
+    }
+
+    /**
+     * Read a file of unknown size (pipe, character device...) into the reused buffer, until its end.
+     * @param fd The file to read.
+     * @param contents Set to the data read.
+     * @return true if the whole file was read, false on error.
+     */
+    bool FileReader::read_stream(int fd, string_view& contents){
+        size_t size = 0;
+        while (true){
+            read_buffer.resize(size + priv::STREAM_READ_CHUNK);
+            ssize_t count = priv::read_fully(fd, read_buffer.data() + size, priv::STREAM_READ_CHUNK);
+            if (count < 0){
+                return false;
+            }
+            size += static_cast<size_t>(count);
+            if (static_cast<size_t>(count) < priv::STREAM_READ_CHUNK){
+                break;
+            }
+        }
+        contents = string_view(read_buffer.data(), size);
+        return true;
+    }
+
+    bool FileReader::open(const string& path, string_view& contents){
+        return open_at(AT_FDCWD, path.c_str(), contents);
+    }
+
+    bool FileReader::open_at(int dir_fd, const char* name, string_view& contents){
+        unmap();
+        contents = string_view();
+
+        int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+        if (fd < 0){
+            return false;
+        }
+        priv::FdCloser closer{fd};
+        return load(fd, contents);
+    }
+
+    bool FileReader::open_fd(int fd, string_view& contents){
+        unmap();
+        contents = string_view();
+        // Part of the file may already have been read by someone else: only what follows is loaded.
+        off_t offset = lseek(fd, 0, SEEK_CUR);
+        if (offset > 0){
+            return read_stream(fd, contents);
+        }
+        return load(fd, contents);
+    }
+
+    /**
+     * Load the contents of an open file, memory-mapping it or reading it depending on its kind and size.
+     * @param fd The file to load.
+     * @param contents Set to the file's contents.
+     * @return true if the file was loaded, false if it couldn't be read (e.g. it is a directory).
+     */
+    bool FileReader::load(int fd, string_view& contents){
+        struct stat info{};
+        if (fstat(fd, &info) != 0 || S_ISDIR(info.st_mode)){
+            return false;
+        }
+        if (!S_ISREG(info.st_mode)){
+            return read_stream(fd, contents);
+        }
+
+        auto size = static_cast<size_t>(info.st_size);
+        if (size == 0){
+            // Some files (e.g. in /proc) report no size but still have contents.
+            return read_stream(fd, contents);
+        }
+
+        if (size >= mmap_threshold){
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED){
+                madvise(mapped, size, MADV_SEQUENTIAL);
+                mapping = mapped;
+                mapping_size = size;
+                contents = string_view(static_cast<const char*>(mapped), size);
+                return true;
+            }
+            // Some files (e.g. on special filesystems) can't be mapped: read them instead.
+        }
+
+        if (read_buffer.size() < size){
+            read_buffer.resize(size);
+        }
+        ssize_t count = priv::read_fully(fd, read_buffer.data(), size);
+        if (count < 0){
+            return false;
+        }
+        contents = string_view(read_buffer.data(), static_cast<size_t>(count));
+        return true;
+    }
+}
@@ -0,0 +1,75 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace cpp_grep{
+    using std::string;
+    using std::string_view;
+
+    /**
+     * @brief Loads files for searching without going through iostreams.
+     *
+     * Regular files at least as large as the mapping threshold are memory-mapped (and read sequentially),
+     * smaller ones are read with a single read() call into a buffer reused from one file to the next.
+     * Either way, the contents are handed out as a view, without any further copy.
+     */
+    class FileReader{
+        size_t mmap_threshold;
+        string read_buffer;
+
+        void* mapping{nullptr};
+        size_t mapping_size{0};
+
+        void unmap();
+        bool read_stream(int fd, string_view& contents);
+        bool load(int fd, string_view& contents);
+
+        public:
+            /**
+             * Create a file reader.
+             * @param mmap_threshold The minimum size (in bytes) of files to memory-map.
+             */
+            explicit FileReader(size_t mmap_threshold);
+
+            ~FileReader();
+
+            // Readers own a mapping and a buffer the views they return point to.
+            FileReader(const FileReader&) = delete;
+            FileReader& operator=(const FileReader&) = delete;
+
+            /**
+             * @brief Load a file's contents.
+             * The returned view stays valid until the next call to open, or until the reader is destroyed.
+             * @param path The path to the file.
+             * @param contents Set to the file's contents.
+             * @return true if the file was loaded, false if it couldn't be opened or read (e.g. it is a directory).
+             */
+            bool open(const string& path, string_view& contents);
+
+            /**
+             * @brief Load the contents of a file, opened relative to a directory.
+             * The returned view stays valid until the next call to open, or until the reader is destroyed.
+             * @param dir_fd The directory the name is relative to, or AT_FDCWD.
+             * @param name The file's name (or path, relative to the directory).
+             * @param contents Set to the file's contents.
+             * @return true if the file was loaded, false if it couldn't be opened or read (e.g. it is a directory).
+             */
+            bool open_at(int dir_fd, const char* name, string_view& contents);
+
+            /**
+             * @brief Load the contents of a file which is already open, such as the standard input.
+             * Only the part following the file's current offset is loaded.
+             * The returned view stays valid until the next call to open, or until the reader is destroyed.
+             * @param fd The file descriptor to read from. It isn't closed.
+             * @param contents Set to the file's contents.
+             * @return true if the file was loaded, false if it couldn't be read (e.g. it is a directory).
+             */
+            bool open_fd(int fd, string_view& contents);
+    };
+}
@@ -0,0 +1,459 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <algorithm>
+#include <cstring>
+
+#include "lazy_dfa.hpp"
+
+namespace cpp_grep{
+    using std::memchr;
+    using std::none_of;
+    using std::sort;
+
+    namespace priv{
+        // If the cache has to be flushed before scanning this many bytes per cached state,
+        // building the DFA costs more than simulating the NFA directly.
+        constexpr size_t DFA_MIN_BYTES_PER_STATE = 10;
+
+        // Rough bookkeeping cost of a state in the lookup table, on top of its contents.
+        constexpr size_t DFA_STATE_OVERHEAD = 64;
+
+        /**
+         * Check if an instruction has to be kept in a DFA state's instruction set.
+         * Instructions which only redirect control flow are fully described by their targets.
+         * @param op The instruction's opcode.
+         * @return true if the instruction is part of a DFA state's identity, false otherwise.
+         */
+        bool is_dfa_state_inst(EOpcode op){
+            switch (op){
+                case EOpcode::SPLIT:
+                case EOpcode::JUMP:
+                case EOpcode::START_ANCHOR:
+                case EOpcode::SAVE:
+                    return false;
+                default:
+                    return true;
+            }
+        }
+    }
+
+    LazyDFA::LazyDFA(const Program& program, size_t cache_limit)
+    : program(&program),
+      cache_limit(cache_limit),
+      closure(static_cast<uint>(program.insts.size())),
+      end_closure(static_cast<uint>(program.insts.size())),
+      follow_stack(2 * program.insts.size() + 1){
+        // If restarting the pattern mid-line can't reach anything (e.g. it is anchored to the start),
+        // a state without live instructions can never lead to a match.
+        closure.clear();
+        follow(closure, 0, false, false);
+        restart_is_dead = none_of(
+            closure.begin(),
+            closure.end(),
+            [&program](uint pc){
+                return priv::is_dfa_state_inst(program.insts[pc].op);
+            }
+        );
+
+        for (uint pc: closure){
+            if (priv::is_dfa_state_inst(program.insts[pc].op)){
+                restart_insts.push_back(pc);
+            }
+        }
+        sort(restart_insts.begin(), restart_insts.end());
+        if (program.has_first_bytes){
+            // Lines end on newlines, which search_lines must not skip.
+            ByteSet skip_stops = program.first_bytes.get_members();
+            skip_stops.insert(static_cast<ubyte>('\n'));
+            skip_scanner = ClassScanner(skip_stops);
+            can_skip = true;
+        }
+    }
+
+    /**
+     * Add an instruction to a set, along with every instruction reachable from it without consuming input.
+     * @param set The set to add to.
+     * @param pc The instruction to start at.
+     * @param at_start Whether the current position is the start of the line.
+     * @param at_end Whether the current position is the end of the line.
+     * @return true if a MATCH instruction was reached, false otherwise.
+     */
+    bool LazyDFA::follow(SparseSet& set, uint pc, bool at_start, bool at_end){
+        bool matched = false;
+        uint top = 0;
+        follow_stack[top++] = pc;
+        while (top > 0){
+            uint cur = follow_stack[--top];
+            if (set.contains(cur)){
+                continue;
+            }
+            set.insert(cur);
+
+            const Inst& inst = program->insts[cur];
+            switch (inst.op){
+                case EOpcode::MATCH:
+                    matched = true;
+                    break;
+                case EOpcode::JUMP:
+                    follow_stack[top++] = cur + inst.x;
+                    break;
+                case EOpcode::SPLIT:
+                    follow_stack[top++] = cur + inst.y;
+                    follow_stack[top++] = cur + inst.x;
+                    break;
+                case EOpcode::SAVE:
+                    follow_stack[top++] = cur + 1;
+                    break;
+                case EOpcode::START_ANCHOR:
+                    if (at_start){
+                        follow_stack[top++] = cur + 1;
+                    }
+                    break;
+                case EOpcode::END_ANCHOR:
+                    // Kept in the state while the end of the line hasn't been reached.
+                    if (at_end){
+                        follow_stack[top++] = cur + 1;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        return matched;
+    }
+
+    /**
+     * Find the cached state matching the current closure, creating it if needed.
+     * The cache is flushed first if the new state doesn't fit in it anymore.
+     * @param at_start Whether the closure was computed at the start of the line.
+     * @return The state's index, or UNKNOWN_STATE if the cache is thrashing and the search should give up.
+     */
+    uint LazyDFA::intern_state(bool at_start){
+        scratch_insts.clear();
+        bool is_match = false;
+        for (uint pc: closure){
+            EOpcode op = program->insts[pc].op;
+            if (priv::is_dfa_state_inst(op)){
+                scratch_insts.push_back(pc);
+                is_match = is_match || op == EOpcode::MATCH;
+            }
+        }
+        sort(scratch_insts.begin(), scratch_insts.end());
+
+        scratch_key.assign(1, at_start ? '\1' : '\0');
+        scratch_key.append(
+            reinterpret_cast<const char*>(scratch_insts.data()),
+            scratch_insts.size() * sizeof(uint)
+        );
+
+        auto found = state_ids.find(scratch_key);
+        if (found != state_ids.end()){
+            return found->second;
+        }
+
+        size_t state_cost = sizeof(DfaState)
+            + priv::DFA_STATE_OVERHEAD
+            + ALPHABET_SIZE * sizeof(uint)
+            + scratch_insts.size() * sizeof(uint)
+            + scratch_key.size();
+        if (!states.empty() && cache_usage + state_cost > cache_limit){
+            if (bytes_since_flush < priv::DFA_MIN_BYTES_PER_STATE * states.size()){
+                return UNKNOWN_STATE;
+            }
+            flush();
+        }
+
+        auto index = static_cast<uint>(states.size());
+        DfaState& state = states.emplace_back();
+        state.insts = scratch_insts;
+        state.at_start = at_start;
+        state.is_match = is_match;
+        state.match_at_end = is_match;
+
+        bool many_patterns = program->pattern_count > 1;
+        end_closure.clear();
+        for (uint pc: state.insts){
+            if (program->insts[pc].op == EOpcode::END_ANCHOR && follow(end_closure, pc + 1, at_start, true)){
+                state.match_at_end = true;
+                if (!many_patterns){
+                    break;
+                }
+            }
+        }
+        if (many_patterns){
+            for (uint pc: state.insts){
+                if (program->insts[pc].op == EOpcode::MATCH){
+                    state.patterns.push_back(program->insts[pc].x);
+                }
+            }
+            for (uint pc: end_closure){
+                if (program->insts[pc].op == EOpcode::MATCH){
+                    state.end_patterns.push_back(program->insts[pc].x);
+                }
+            }
+        }
+        state.is_restart = !at_start && state.insts == restart_insts;
+        // Without live instructions, only a restart at the next position can lead to a match.
+        state.is_dead = state.insts.empty() && restart_is_dead;
+
+        transitions.resize(transitions.size() + ALPHABET_SIZE, UNKNOWN_STATE);
+        state_ids.emplace(scratch_key, index);
+        cache_usage += state_cost;
+        return index;
+    }
+
+    /**
+     * Compute (and cache) the state reached from another one after reading a character.
+     * @param state The state to start from.
+     * @param chr The character read.
+     * @return The next state, or UNKNOWN_STATE if the search should give up.
+     */
+    uint LazyDFA::compute_transition(uint state, ubyte chr){
+        closure.clear();
+        for (uint pc: states[state].insts){
+            if (program->accepts(program->insts[pc], static_cast<char>(chr))){
+                follow(closure, pc + 1, false, false);
+            }
+        }
+        // Unanchored search: a new thread starts at every position.
+        follow(closure, 0, false, false);
+
+        size_t flushes_before = flush_count;
+        uint next_state = intern_state(false);
+        if (next_state != UNKNOWN_STATE && flush_count == flushes_before){
+            // The source state is gone after a flush, so only cache the transition if it still exists.
+            transitions[state * ALPHABET_SIZE + chr] = next_state;
+        }
+        return next_state;
+    }
+
+    /**
+     * Empty the state cache.
+     */
+    void LazyDFA::flush(){
+        states.clear();
+        transitions.clear();
+        state_ids.clear();
+        cache_usage = 0;
+        bytes_since_flush = 0;
+        start_state = UNKNOWN_STATE;
+        flush_count++;
+    }
+
+    /**
+     * Get the state a search starts in, creating it if needed.
+     * @return The start state's index, or UNKNOWN_STATE if the search should give up.
+     */
+    uint LazyDFA::get_start_state(){
+        if (start_state == UNKNOWN_STATE){
+            closure.clear();
+            follow(closure, 0, true, false);
+            start_state = intern_state(true);
+        }
+        return start_state;
+    }
+
+    /**
+     * Skip the bytes which leave the restart state as it is.
+     * @param input The input being scanned.
+     * @param pos The position of the next byte to read, in the restart state.
+     * @return The position of the next byte which can start a match or is a newline, or the input's size.
+     */
+    size_t LazyDFA::skip_restart(string_view input, size_t pos) const{
+        return pos + skip_scanner.find_first(input.data() + pos, input.size() - pos);
+    }
+
+    EDfaResult LazyDFA::search(string_view input_line){
+        uint state = get_start_state();
+        if (state == UNKNOWN_STATE){
+            return EDfaResult::GAVE_UP;
+        }
+        if (states[state].is_match){
+            return EDfaResult::MATCH;
+        }
+
+        size_t size = input_line.size();
+        for (size_t i = 0; i < size; ++i){
+            if (can_skip && states[state].is_restart){
+                size_t next = skip_restart(input_line, i);
+                bytes_since_flush += next - i;
+                i = next;
+                if (i == size){
+                    break;
+                }
+            }
+
+            auto chr = static_cast<ubyte>(input_line[i]);
+            uint next_state = transitions[state * ALPHABET_SIZE + chr];
+            if (next_state == UNKNOWN_STATE){
+                next_state = compute_transition(state, chr);
+                if (next_state == UNKNOWN_STATE){
+                    return EDfaResult::GAVE_UP;
+                }
+            }
+            bytes_since_flush++;
+            state = next_state;
+
+            const DfaState& info = states[state];
+            if (info.is_match){
+                return EDfaResult::MATCH;
+            }
+            if (info.is_dead){
+                return EDfaResult::NO_MATCH;
+            }
+        }
+        return states[state].match_at_end ? EDfaResult::MATCH : EDfaResult::NO_MATCH;
+    }
+
+    EDfaResult LazyDFA::search_reverse(string_view input_line){
+        uint state = get_start_state();
+        if (state == UNKNOWN_STATE){
+            return EDfaResult::GAVE_UP;
+        }
+        if (states[state].is_match){
+            return EDfaResult::MATCH;
+        }
+
+        for (size_t i = input_line.size(); i > 0; --i){
+            auto chr = static_cast<ubyte>(input_line[i - 1]);
+            uint next_state = transitions[state * ALPHABET_SIZE + chr];
+            if (next_state == UNKNOWN_STATE){
+                next_state = compute_transition(state, chr);
+                if (next_state == UNKNOWN_STATE){
+                    return EDfaResult::GAVE_UP;
+                }
+            }
+            bytes_since_flush++;
+            state = next_state;
+
+            const DfaState& info = states[state];
+            if (info.is_match){
+                return EDfaResult::MATCH;
+            }
+            if (info.is_dead){
+                return EDfaResult::NO_MATCH;
+            }
+        }
+        return states[state].match_at_end ? EDfaResult::MATCH : EDfaResult::NO_MATCH;
+    }
+
+    EDfaResult LazyDFA::search_lines(string_view buffer, size_t& pos){
+        size_t size = buffer.size();
+        if (size == 0){
+            return EDfaResult::NO_MATCH;
+        }
+
+        pos = 0;
+        uint state = get_start_state();
+        if (state == UNKNOWN_STATE){
+            return EDfaResult::GAVE_UP;
+        }
+        if (states[state].is_match){
+            return EDfaResult::MATCH;
+        }
+
+        for (size_t i = 0; i < size; ++i){
+            if (can_skip && states[state].is_restart){
+                size_t next = skip_restart(buffer, i);
+                bytes_since_flush += next - i;
+                i = next;
+                if (i == size){
+                    break;
+                }
+            }
+
+            char input = buffer[i];
+            if (input == '\n'){
+                if (states[state].match_at_end){
+                    pos = i;
+                    return EDfaResult::MATCH;
+                }
+                if (i + 1 == size){
+                    // A trailing newline doesn't start another line.
+                    return EDfaResult::NO_MATCH;
+                }
+                pos = i + 1;
+                state = get_start_state();
+                if (state == UNKNOWN_STATE){
+                    return EDfaResult::GAVE_UP;
+                }
+                if (states[state].is_match){
+                    return EDfaResult::MATCH;
+                }
+                continue;
+            }
+
+            auto chr = static_cast<ubyte>(input);
+            uint next_state = transitions[state * ALPHABET_SIZE + chr];
+            if (next_state == UNKNOWN_STATE){
+                next_state = compute_transition(state, chr);
+                if (next_state == UNKNOWN_STATE){
+                    pos = i;
+                    return EDfaResult::GAVE_UP;
+                }
+            }
+            bytes_since_flush++;
+            state = next_state;
+
+            const DfaState& info = states[state];
+            if (info.is_match){
+                pos = i;
+                return EDfaResult::MATCH;
+            }
+            if (info.is_dead){
+                // Nothing can match in the rest of this line: jump straight to its end.
+                const void* newline = memchr(buffer.data() + i + 1, '\n', size - i - 1);
+                if (newline == nullptr){
+                    return EDfaResult::NO_MATCH;
+                }
+                i = static_cast<const char*>(newline) - buffer.data() - 1;
+            }
+        }
+
+        if (states[state].match_at_end){
+            pos = size;
+            return EDfaResult::MATCH;
+        }
+        return EDfaResult::NO_MATCH;
+    }
+
+    EDfaResult LazyDFA::collect_matches(string_view input_line, vector<uint>& patterns){
+        uint state = get_start_state();
+        if (state == UNKNOWN_STATE){
+            return EDfaResult::GAVE_UP;
+        }
+        patterns.insert(patterns.end(), states[state].patterns.begin(), states[state].patterns.end());
+
+        for (char input: input_line){
+            auto chr = static_cast<ubyte>(input);
+            uint next_state = transitions[state * ALPHABET_SIZE + chr];
+            if (next_state == UNKNOWN_STATE){
+                next_state = compute_transition(state, chr);
+                if (next_state == UNKNOWN_STATE){
+                    return EDfaResult::GAVE_UP;
+                }
+            }
+            bytes_since_flush++;
+            state = next_state;
+
+            const DfaState& info = states[state];
+            patterns.insert(patterns.end(), info.patterns.begin(), info.patterns.end());
+            if (info.is_dead){
+                return patterns.empty() ? EDfaResult::NO_MATCH : EDfaResult::MATCH;
+            }
+        }
+        const DfaState& info = states[state];
+        patterns.insert(patterns.end(), info.end_patterns.begin(), info.end_patterns.end());
+        return patterns.empty() ? EDfaResult::NO_MATCH : EDfaResult::MATCH;
+    }
+
+    size_t LazyDFA::get_flush_count() const{
+        return flush_count;
+    }
+
+    size_t LazyDFA::get_state_count() const{
+        return states.size();
+    }
+}
@@ -0,0 +1,145 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "program.hpp"
+#include "sparse_set.hpp"
+
+namespace cpp_grep{
+    using ubyte = uint8_t;
+    using uint = uint32_t;
+
+    using std::string;
+    using std::string_view;
+    using std::unordered_map;
+    using std::vector;
+
+    // The outcome of a lazy DFA search.
+    enum class EDfaResult: ubyte{
+        MATCH,      // The pattern was found in the line.
+        NO_MATCH,   // The pattern cannot be found in the line.
+        GAVE_UP,    // The state cache thrashed too much; the line should be searched with another engine.
+    };
+
+    /**
+     * @brief A DFA built lazily from a compiled program while scanning input.
+     *
+     * Each DFA state stands for the set of program instructions alive at a given position.
+     * States and their transitions are only computed the first time they are needed, and are
+     * kept in a cache whose memory usage is capped. Once the cache is full it is flushed and
+     * rebuilt from the current state. A cached transition costs a single table lookup per byte.
+     * While no match is in progress, bytes which can't start one are skipped with a class scan.
+     */
+    class LazyDFA{
+        /**
+         * @brief A cached DFA state.
+         */
+        struct DfaState{
+            vector<uint> insts;         // Sorted program instructions alive in this state.
+            bool at_start{false};       // Whether this state only exists at the start of a line.
+            bool is_match{false};       // Whether a MATCH instruction was reached.
+            bool is_dead{false};        // Whether no match can be found from this state onwards.
+            bool match_at_end{false};   // Whether the line matches if it ends in this state.
+            bool is_restart{false};     // Whether no match is in progress, only a restart of the pattern at each position.
+            vector<uint> patterns;      // Patterns matched in this state (only kept for programs with several patterns).
+            vector<uint> end_patterns;  // Patterns matched if the line ends in this state (same).
+        };
+
+        static constexpr uint UNKNOWN_STATE = UINT32_MAX;
+        static constexpr uint ALPHABET_SIZE = 256;
+
+        const Program* program;
+        size_t cache_limit;
+        size_t cache_usage{0};
+        size_t flush_count{0};
+        size_t bytes_since_flush{0};
+        bool restart_is_dead{false};
+        vector<uint> restart_insts;     // The instructions of the restart state (see DfaState::is_restart).
+        bool can_skip{false};           // Whether bytes which can't start a match can be skipped from the restart state.
+        ClassScanner skip_scanner;      // The program's first bytes, and the newline.
+
+        vector<DfaState> states;
+        vector<uint> transitions;               // ALPHABET_SIZE entries per state.
+        unordered_map<string, uint> state_ids;  // State lookup by serialised contents.
+        uint start_state{UNKNOWN_STATE};
+
+        SparseSet closure;
+        SparseSet end_closure;
+        vector<uint> follow_stack;
+        vector<uint> scratch_insts;
+        string scratch_key;
+
+        bool follow(SparseSet& set, uint pc, bool at_start, bool at_end);
+        uint intern_state(bool at_start);
+        uint compute_transition(uint state, ubyte chr);
+        uint get_start_state();
+        void flush();
+        [[nodiscard]] size_t skip_restart(string_view input, size_t pos) const;
+
+        public:
+            /**
+             * Prepare a lazy DFA for the given program.
+             * @param program The program to run. It must outlive the DFA and must not contain backreferences.
+             * @param cache_limit The maximum amount of memory (in bytes) the state cache may use before being flushed.
+             */
+            LazyDFA(const Program& program, size_t cache_limit);
+
+            /**
+             * @brief Check if the program matches anywhere in the given line.
+             * @param input_line The line to search.
+             * @return The search outcome. GAVE_UP is returned if the cache kept being flushed while scanning the line.
+             */
+            [[nodiscard]] EDfaResult search(string_view input_line);
+
+            /**
+             * @brief Check if the program matches anywhere in the given line, reading it from its end.
+             * Meant for programs built with compile_program_reversed: for those which are start-anchored,
+             * the search stops as soon as no match can be in progress anymore.
+             * @param input_line The line to search.
+             * @return The search outcome. GAVE_UP is returned if the cache kept being flushed while scanning the line.
+             */
+            [[nodiscard]] EDfaResult search_reverse(string_view input_line);
+
+            /**
+             * @brief Find the first line of a buffer in which the program matches.
+             *
+             * Lines are separated by '\n' and the whole buffer is scanned in a single pass:
+             * the DFA is simply reset to its start state after each newline, and lines in which
+             * no match is possible anymore are skipped with memchr.
+             * @param buffer The buffer to search. A trailing newline doesn't start an extra line.
+             * @param pos Set to the position at which a match was detected (or at which the DFA gave up).
+             * It is either inside the line in question, on the newline ending it, or the buffer's size for the last line.
+             * @return The search outcome. NO_MATCH means no line of the buffer matches.
+             */
+            [[nodiscard]] EDfaResult search_lines(string_view buffer, size_t& pos);
+
+            /**
+             * @brief Find every pattern of a program compiled from several ones which matches in a line.
+             * Unlike search, the whole line is scanned even after a first match.
+             * @param input_line The line to search.
+             * @param patterns The indices of the matched patterns are appended to it, possibly more than once.
+             * @return The search outcome. On GAVE_UP, the patterns appended so far are incomplete.
+             */
+            [[nodiscard]] EDfaResult collect_matches(string_view input_line, vector<uint>& patterns);
+
+            /**
+             * Get how many times the state cache was flushed since this DFA was created.
+             * @return The amount of cache flushes.
+             */
+            [[nodiscard]] size_t get_flush_count() const;
+
+            /**
+             * Get how many states are currently cached.
+             * @return The amount of cached states.
+             */
+            [[nodiscard]] size_t get_state_count() const;
+    };
+}
@@ -0,0 +1,352 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "line_matcher.hpp"
+#include "matcher.hpp"
+
+namespace cpp_grep{
+    using std::memchr;
+    using std::move;
+    using std::sort;
+    using std::unique;
+
+    namespace priv{
+        /**
+         * Check if a whole pattern is a single bracket expression, such as "[a-z]" or "[^abc]".
+         * @param pattern The pattern to check.
+         * @return true if the only closing bracket ends the pattern, false otherwise.
+         */
+        bool is_single_char_group(const string& pattern){
+            return pattern.starts_with('[') && pattern.find(']') == pattern.size() - 1;
+        }
+
+        /**
+         * Pick the fast path used for a pattern, if any.
+         * @param pattern The pattern to check.
+         * @return The pattern's fast path, or NONE if it has to be compiled.
+         * @throw runtime_error if the pattern is empty.
+         */
+        EFastPath pick_fast_path(const string& pattern){
+            if (pattern.empty()){
+                throw runtime_error("Unhandled pattern " + pattern);
+            }
+            if (pattern.length() == 1){
+                return EFastPath::LITERAL_CHAR;
+            }
+            if (pattern == DIGIT_CLS_PATTERN || pattern == WORD_CLS_PATTERN || is_single_char_group(pattern)){
+                return EFastPath::CHAR_CLASS;
+            }
+            return EFastPath::NONE;
+        }
+
+        /**
+         * Check if a parsed pattern only matches one string, spelled out by literal characters.
+         * @param portions The parsed pattern.
+         * @return true if every portion is a literal other than a newline, false otherwise.
+         */
+        bool is_plain_literal(const vector<RegexPatternPortion>& portions){
+            for (const auto& portion: portions){
+                if (portion.get_char_cls() != ECharClass::LITERAL || portion.get_literal() == '\n'){
+                    return false;
+                }
+            }
+            return !portions.empty();
+        }
+
+        /**
+         * Build the class matched by a CHAR_CLASS pattern.
+         * @param pattern The pattern, either "\d", "\w" or a single bracket expression.
+         * @return The bytes a line has to contain to be matched.
+         */
+        ByteSet fast_path_class(const string& pattern){
+            if (pattern == DIGIT_CLS_PATTERN){
+                return digit_scanner().get_members();
+            }
+            if (pattern == WORD_CLS_PATTERN){
+                return word_scanner().get_members();
+            }
+            // Don't count the brackets, they simply delimit the group itself.
+            auto stripped_pattern = pattern.substr(1, pattern.size() - 2);
+            if (stripped_pattern.starts_with('^')){
+                ByteSet char_set = ByteSet::from_char_group(stripped_pattern.substr(1));
+                char_set.invert();
+                return char_set;
+            }
+            return ByteSet::from_char_group(stripped_pattern);
+        }
+
+        /**
+         * Find the bounds of the line containing a position of a buffer.
+         * @param buffer The buffer the line is in.
+         * @param pos A position inside the line, or the position of the newline ending it.
+         * @return The line, without its newline.
+         */
+        string_view line_around(string_view buffer, size_t pos){
+            const char* data = buffer.data();
+            size_t start = 0;
+            if (pos > 0){
+                const void* prev_newline = memrchr(data, '\n', pos);
+                if (prev_newline != nullptr){
+                    start = static_cast<const char*>(prev_newline) - data + 1;
+                }
+            }
+            size_t end = buffer.size();
+            if (pos < buffer.size()){
+                const void* next_newline = memchr(data + pos, '\n', buffer.size() - pos);
+                if (next_newline != nullptr){
+                    end = static_cast<const char*>(next_newline) - data;
+                }
+            }
+            return buffer.substr(start, end - start);
+        }
+
+        /**
+         * Get the position right after a line of a buffer, i.e. the start of the next one.
+         * @param buffer The buffer the line is in.
+         * @param line The line, as a view into the buffer.
+         * @return The position after the line's newline.
+         */
+        size_t after_line(string_view buffer, string_view line){
+            return static_cast<size_t>(line.data() - buffer.data()) + line.size() + 1;
+        }
+    }
+
+    CompiledPattern::CompiledPattern(const vector<string>& patterns, bool fixed_strings): patterns(patterns){
+        if (fixed_strings || patterns.empty()){
+            // Without any pattern, an empty set of fixed strings is the simplest way never to match.
+            fast_path = EFastPath::LITERAL_SET;
+            literal_set = make_unique<AhoCorasick>(patterns);
+            return;
+        }
+        if (patterns.size() > 1){
+            vector<vector<RegexPatternPortion>> pattern_portions;
+            pattern_portions.reserve(patterns.size());
+            for (const auto& pattern: patterns){
+                if (pattern.empty()){
+                    throw runtime_error("Unhandled pattern " + pattern);
+                }
+                uint group_count = 0;
+                pattern_portions.push_back(extract_patterns(pattern, group_count));
+            }
+            program = compile_program_set(pattern_portions);
+            return;
+        }
+
+        const string& pattern = patterns.front();
+        fast_path = priv::pick_fast_path(pattern);
+        vector<RegexPatternPortion> portions;
+        if (fast_path == EFastPath::NONE){
+            uint group_count = 0;
+            portions = extract_patterns(pattern, group_count);
+            if (priv::is_plain_literal(portions)){
+                fast_path = EFastPath::LITERAL_STRING;
+            }
+        }
+        required_literal = fast_path == EFastPath::LITERAL_CHAR ? pattern : find_required_literal(portions);
+        literal_searcher = LiteralSearcher(required_literal);
+        program = compile_program(portions);
+        if (program.has_backrefs){
+            relaxed_program = relax_backreferences(program);
+        }
+        else if (fast_path == EFastPath::NONE && !program.anchored_start){
+            Program reversed = compile_program_reversed(portions);
+            if (reversed.anchored_start){
+                end_anchored = true;
+                reverse_program = move(reversed);
+            }
+        }
+        if (fast_path == EFastPath::CHAR_CLASS){
+            class_scanner = ClassScanner(priv::fast_path_class(pattern));
+        }
+    }
+
+    LineMatcher::LineMatcher(const CompiledPattern& pattern, const SearchOptions& options)
+    : pattern(&pattern){
+        if (pattern.fast_path != EFastPath::NONE){
+            return;
+        }
+        // With backreferences, the automata only reject lines: the ones they accept still have to be confirmed.
+        const Program& automaton_program = pattern.program.has_backrefs ? pattern.relaxed_program : pattern.program;
+        pike_vm = make_unique<PikeVM>(automaton_program);
+        lazy_dfa = make_unique<LazyDFA>(automaton_program, options.dfa_cache_size);
+        if (pattern.program.has_backrefs){
+            bit_state = make_unique<BitState>(pattern.program, options.backtrack_memory);
+        }
+        if (pattern.end_anchored){
+            reverse_dfa = make_unique<LazyDFA>(pattern.reverse_program, options.dfa_cache_size);
+        }
+    }
+
+    /**
+     * Confirm that a line accepted by the automata is matched by the pattern.
+     * @param input_line The accepted line.
+     * @return true if the pattern matches the line, false otherwise.
+     */
+    bool LineMatcher::confirm(string_view input_line){
+        if (bit_state == nullptr){
+            // Without backreferences, the automata are exact.
+            return true;
+        }
+        return bit_state->search(input_line);
+    }
+
+    bool LineMatcher::matches(string_view input_line){
+        if (pattern->fast_path == EFastPath::LITERAL_SET){
+            uint found_pattern = 0;
+            return pattern->literal_set->find(input_line, found_pattern) != string_view::npos;
+        }
+        if (pattern->fast_path == EFastPath::CHAR_CLASS){
+            return pattern->class_scanner.any_of(input_line.data(), input_line.size());
+        }
+
+        // Anchored patterns only look at one end of the line, which costs less than searching all of it for the literal.
+        bool anchored = pattern->program.anchored_start || pattern->end_anchored;
+        if (!anchored && !pattern->required_literal.empty() && !pattern->literal_searcher.occurs_in(input_line)){
+            return false;
+        }
+        if (pattern->fast_path == EFastPath::LITERAL_CHAR || pattern->fast_path == EFastPath::LITERAL_STRING){
+            return true;
+        }
+
+        if (reverse_dfa != nullptr){
+            switch (reverse_dfa->search_reverse(input_line)){
+                case EDfaResult::MATCH:
+                    return true;
+                case EDfaResult::NO_MATCH:
+                    return false;
+                case EDfaResult::GAVE_UP:
+                    // Search forwards instead.
+                    break;
+            }
+        }
+
+        bool candidate = false;
+        switch (lazy_dfa->search(input_line)){
+            case EDfaResult::MATCH:
+                candidate = true;
+                break;
+            case EDfaResult::NO_MATCH:
+                return false;
+            case EDfaResult::GAVE_UP:
+                // The state cache is thrashing on this line: simulate the NFA instead.
+                candidate = pike_vm->search(input_line);
+                break;
+        }
+        return candidate && confirm(input_line);
+    }
+
+    bool LineMatcher::find_matching_line(string_view buffer, size_t from, string_view& line){
+        size_t size = buffer.size();
+        while (from < size){
+            string_view rest = buffer.substr(from);
+
+            if (pattern->fast_path == EFastPath::LITERAL_SET){
+                // No fixed string contains a newline, so occurrences never straddle two lines.
+                uint found_pattern = 0;
+                size_t end = pattern->literal_set->find(rest, found_pattern);
+                if (end == string_view::npos){
+                    return false;
+                }
+                line = priv::line_around(buffer, from + (end > 0 ? end - 1 : 0));
+                return true;
+            }
+
+            if (pattern->fast_path == EFastPath::CHAR_CLASS){
+                size_t found = from + pattern->class_scanner.find_first(rest.data(), rest.size());
+                if (found == size){
+                    return false;
+                }
+                if (buffer[found] == '\n'){
+                    // Negative groups contain the newline, which isn't part of any line.
+                    from = found + 1;
+                    continue;
+                }
+                line = priv::line_around(buffer, found);
+                return true;
+            }
+
+            if (!pattern->required_literal.empty()){
+                size_t found = pattern->literal_searcher.find(rest);
+                if (found == string_view::npos){
+                    return false;
+                }
+                line = priv::line_around(buffer, from + found);
+                if (pattern->fast_path == EFastPath::LITERAL_STRING || matches(line)){
+                    return true;
+                }
+                from = priv::after_line(buffer, line);
+                continue;
+            }
+
+            if (reverse_dfa != nullptr){
+                // Matches end with their line: only look at the end of each one.
+                line = priv::line_around(buffer, from);
+                if (matches(line)){
+                    return true;
+                }
+                from = priv::after_line(buffer, line);
+                continue;
+            }
+
+            size_t pos = 0;
+            switch (lazy_dfa->search_lines(rest, pos)){
+                case EDfaResult::MATCH:
+                    line = priv::line_around(buffer, from + pos);
+                    if (confirm(line)){
+                        return true;
+                    }
+                    break;
+                case EDfaResult::NO_MATCH:
+                    return false;
+                case EDfaResult::GAVE_UP:
+                    // Lines before this one were already rejected: only this one needs the NFA.
+                    line = priv::line_around(buffer, from + pos);
+                    if (pike_vm->search(line) && confirm(line)){
+                        return true;
+                    }
+                    break;
+            }
+            from = priv::after_line(buffer, line);
+        }
+        return false;
+    }
+
+    const vector<uint>& LineMatcher::collect_matched_patterns(string_view input_line){
+        matched_patterns.clear();
+        if (pattern->fast_path == EFastPath::LITERAL_SET){
+            pattern->literal_set->find_all(input_line, matched_patterns);
+        }
+        else if (pattern->program.pattern_count > 1){
+            if (lazy_dfa->collect_matches(input_line, matched_patterns) == EDfaResult::GAVE_UP){
+                matched_patterns.clear();
+                pike_vm->collect_matches(input_line, matched_patterns);
+            }
+        }
+        else if (matches(input_line)){
+            matched_patterns.push_back(0);
+        }
+        sort(matched_patterns.begin(), matched_patterns.end());
+        matched_patterns.erase(unique(matched_patterns.begin(), matched_patterns.end()), matched_patterns.end());
+        return matched_patterns;
+    }
+
+    const CompiledPattern& LineMatcher::get_pattern() const{
+        return *pattern;
+    }
+
+    size_t LineMatcher::get_dfa_flush_count() const{
+        if (lazy_dfa == nullptr){
+            return 0;
+        }
+        size_t flush_count = lazy_dfa->get_flush_count();
+        if (reverse_dfa != nullptr){
+            flush_count += reverse_dfa->get_flush_count();
+        }
+        return flush_count;
+    }
+}
@@ -0,0 +1,149 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aho_corasick.hpp"
+#include "bit_state.hpp"
+#include "chr_classes.hpp"
+#include "class_scan.hpp"
+#include "lazy_dfa.hpp"
+#include "literal_search.hpp"
+#include "pike_vm.hpp"
+#include "prefilter.hpp"
+#include "program.hpp"
+#include "search_options.hpp"
+
+namespace cpp_grep{
+    using std::make_unique;
+    using std::string;
+    using std::string_view;
+    using std::unique_ptr;
+    using std::vector;
+
+    // Patterns which don't need any engine at all.
+    enum class EFastPath: ubyte{
+        NONE,           // Any other pattern.
+        LITERAL_CHAR,   // A single character, matched literally.
+        LITERAL_STRING, // Only literal characters: a line matches if it contains them.
+        CHAR_CLASS,     // "\d", "\w" or a single bracket expression: a line matches if any of its bytes is in the class.
+        LITERAL_SET,    // Fixed strings: a line matches if it contains any of them.
+    };
+
+    /**
+     * @brief A pattern compiled once, then only read by the LineMatcher objects using it.
+     *
+     * Nothing in here changes while searching, so a single compiled pattern can be shared by every thread of a search.
+     */
+    struct CompiledPattern{
+        EFastPath fast_path{EFastPath::NONE};
+        ClassScanner class_scanner;     // Only used by CHAR_CLASS patterns.
+        vector<string> patterns;        // The patterns as given, to report which ones matched.
+        unique_ptr<AhoCorasick> literal_set;    // Only used by LITERAL_SET patterns.
+        string required_literal;        // A literal every matched line contains, or an empty string.
+        LiteralSearcher literal_searcher;   // Searches for the required literal.
+        Program program;
+        Program relaxed_program;        // Only built for patterns with backreferences, see relax_backreferences.
+        bool end_anchored{false};       // Whether every match ends at the end of the line, and none starts at its start.
+        Program reverse_program;        // Only built for end-anchored patterns, see compile_program_reversed.
+
+        /**
+         * Compile a pattern, or a set of patterns matched together.
+         * Several regular expressions are compiled into a single program, so each line is only scanned once for all of them.
+         * @param patterns The patterns to compile. A line matches if any of them matches.
+         * @param fixed_strings Whether the patterns are literal strings instead of regular expressions.
+         * @throw runtime_error if a regular expression is empty, or if one of several contains backreferences.
+         */
+        CompiledPattern(const vector<string>& patterns, bool fixed_strings);
+    };
+
+    /**
+     * @brief Matches a compiled pattern against many lines.
+     *
+     * Fixed strings are all searched for at once with an Aho-Corasick automaton, and sets of
+     * regular expressions are compiled into a single program.
+     * Lines lacking a literal which every match must contain are rejected up front with a substring search,
+     * which is all there is to do for patterns made of literal characters only.
+     * Backreference-free patterns are run on a lazy DFA, falling back to a Pike VM for lines
+     * on which the DFA gives up. Patterns with backreferences are first run the same way with each
+     * backreference relaxed into whatever its group can match, and only the lines this accepts are
+     * confirmed with a memoizing backtracker (BitState).
+     * Patterns anchored to the start of the line are only tried there, and patterns anchored to its end
+     * (without backreferences) are run backwards from it with a reversed program, so matching a line
+     * takes work bounded by the match's length rather than the line's.
+     *
+     * Whole buffers can also be searched at once: line boundaries are then only looked for
+     * around candidate matches, instead of splitting the buffer into lines up front.
+     *
+     * Matchers hold the engines' caches and scratch memory, so each thread needs its own.
+     */
+    class LineMatcher{
+        const CompiledPattern* pattern;
+        vector<uint> matched_patterns;
+
+        unique_ptr<PikeVM> pike_vm;
+        unique_ptr<LazyDFA> lazy_dfa;
+        unique_ptr<LazyDFA> reverse_dfa;
+        unique_ptr<BitState> bit_state;
+
+        [[nodiscard]] bool confirm(string_view input_line);
+
+        public:
+            /**
+             * Pick the engine used to match a compiled pattern.
+             * @param pattern The compiled pattern. It must outlive the matcher.
+             * @param options The search options (DFA cache size, backtracking memory limit, etc.).
+             */
+            LineMatcher(const CompiledPattern& pattern, const SearchOptions& options);
+
+            // Engines keep pointers to the compiled program, so matchers cannot be copied.
+            LineMatcher(const LineMatcher&) = delete;
+            LineMatcher& operator=(const LineMatcher&) = delete;
+
+            /**
+             * @brief Check if the pattern matches anywhere in a line.
+             * @param input_line The line to check.
+             * @return true if a match was found, false otherwise.
+             */
+            [[nodiscard]] bool matches(string_view input_line);
+
+            /**
+             * @brief Find the first line of a buffer matched by the pattern.
+             *
+             * Lines are separated by '\n', and a trailing newline doesn't start an extra line
+             * (the same lines getline would yield). Candidates are found across the whole buffer
+             * with the cheapest available search (class scan, substring search or lazy DFA),
+             * and only the line around each candidate is looked at afterwards.
+             * @param buffer The buffer to search.
+             * @param from Where to start searching. Must be the start of a line.
+             * @param line Set to the matched line (without its newline), as a view into the buffer.
+             * @return true if a line was matched, false if no line from the given position matches.
+             */
+            [[nodiscard]] bool find_matching_line(string_view buffer, size_t from, string_view& line);
+
+            /**
+             * @brief Find which of the patterns match in a line.
+             * @param input_line The line, usually one which was already matched.
+             * @return The indices of the matching patterns, in increasing order. Only valid until the next call.
+             */
+            [[nodiscard]] const vector<uint>& collect_matched_patterns(string_view input_line);
+
+            /**
+             * Get the compiled pattern this matcher runs.
+             * @return The compiled pattern.
+             */
+            [[nodiscard]] const CompiledPattern& get_pattern() const;
+
+            /**
+             * Get how many times the lazy DFAs' state caches were flushed.
+             * @return The amount of cache flushes, or 0 if the pattern doesn't use the lazy DFA.
+             */
+            [[nodiscard]] size_t get_dfa_flush_count() const;
+    };
+}
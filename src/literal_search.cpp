@@ -0,0 +1,188 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <bit>
+#include <cstring>
+#include <utility>
+
+#include "class_scan.hpp"
+#include "literal_search.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define CPP_GREP_X86_SIMD 1
+    #include <immintrin.h>
+#endif
+
+namespace cpp_grep{
+    using std::countr_zero;
+    using std::memchr;
+    using std::memcmp;
+    using std::move;
+
+    LiteralSearcher::LiteralSearcher(string literal): needle(move(literal)){
+        size_t length = needle.size();
+        if (length == 0){
+            kernel = EKernel::EMPTY;
+        }
+        else if (length == 1){
+            kernel = EKernel::SINGLE_BYTE;
+        }
+        else if (length <= MAX_PAIR_LENGTH && priv::cpu_has_avx2()){
+            kernel = EKernel::AVX2_PAIR;
+        }
+        else if (length <= MAX_PAIR_LENGTH && priv::cpu_has_sse2()){
+            kernel = EKernel::SSE2_PAIR;
+        }
+        else{
+            kernel = EKernel::HORSPOOL;
+            // Each byte moves the window so that its last occurrence in the needle (last byte excluded) lines up with it.
+            shifts.fill(length);
+            for (size_t i = 0; i + 1 < length; ++i){
+                shifts[static_cast<ubyte>(needle[i])] = length - 1 - i;
+            }
+        }
+    }
+
+    /**
+     * Check if the needle occurs at a position whose first and last bytes are already known to match.
+     * @param data The position to check. At least the needle's length must be readable from it.
+     * @return true if the bytes in between match too, false otherwise.
+     */
+    bool LiteralSearcher::matches_at(const char* data) const{
+        return memcmp(data + 1, needle.data() + 1, needle.size() - 2) == 0;
+    }
+
+    /**
+     * Find the first occurrence of the needle from a position, comparing its first and last bytes one position at a time.
+     * Used for the ends of buffers which are too short for a full vector.
+     * @param data The start of the buffer.
+     * @param size The size of the buffer.
+     * @param from The first position to check.
+     * @return The index of the first occurrence, or string_view::npos if there isn't any.
+     */
+    size_t LiteralSearcher::find_pair_scalar(const char* data, size_t size, size_t from) const{
+        size_t last = needle.size() - 1;
+        for (size_t pos = from; pos + last < size; ++pos){
+            if (data[pos] == needle.front() && data[pos + last] == needle.back() && matches_at(data + pos)){
+                return pos;
+            }
+        }
+        return string_view::npos;
+    }
+
+    #ifdef CPP_GREP_X86_SIMD
+    /**
+     * Find the first occurrence of the needle, comparing its first and last bytes against 16 positions at a time.
+     * @param data The start of the buffer.
+     * @param size The size of the buffer.
+     * @return The index of the first occurrence, or string_view::npos if there isn't any.
+     */
+    __attribute__((target("sse2")))
+    size_t LiteralSearcher::find_sse2(const char* data, size_t size) const{
+        size_t last = needle.size() - 1;
+        const __m128i first_byte = _mm_set1_epi8(needle.front());
+        const __m128i last_byte = _mm_set1_epi8(needle.back());
+
+        size_t i = 0;
+        for (; i + last + 16 <= size; i += 16){
+            __m128i starts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i ends = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + last));
+            __m128i hits = _mm_and_si128(_mm_cmpeq_epi8(starts, first_byte), _mm_cmpeq_epi8(ends, last_byte));
+            auto mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+            while (mask != 0){
+                size_t pos = i + countr_zero(mask);
+                if (matches_at(data + pos)){
+                    return pos;
+                }
+                mask &= mask - 1;
+            }
+        }
+        return find_pair_scalar(data, size, i);
+    }
+
+    /**
+     * Find the first occurrence of the needle, comparing its first and last bytes against 32 positions at a time.
+     * @param data The start of the buffer.
+     * @param size The size of the buffer.
+     * @return The index of the first occurrence, or string_view::npos if there isn't any.
+     */
+    __attribute__((target("avx2")))
+    size_t LiteralSearcher::find_avx2(const char* data, size_t size) const{
+        size_t last = needle.size() - 1;
+        const __m256i first_byte = _mm256_set1_epi8(needle.front());
+        const __m256i last_byte = _mm256_set1_epi8(needle.back());
+
+        size_t i = 0;
+        for (; i + last + 32 <= size; i += 32){
+            __m256i starts = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            __m256i ends = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + last));
+            __m256i hits = _mm256_and_si256(_mm256_cmpeq_epi8(starts, first_byte), _mm256_cmpeq_epi8(ends, last_byte));
+            auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+            while (mask != 0){
+                size_t pos = i + countr_zero(mask);
+                if (matches_at(data + pos)){
+                    return pos;
+                }
+                mask &= mask - 1;
+            }
+        }
+        return find_pair_scalar(data, size, i);
+    }
+    #else
+    size_t LiteralSearcher::find_sse2(const char* data, size_t size) const{
+        return find_pair_scalar(data, size, 0);
+    }
+
+    size_t LiteralSearcher::find_avx2(const char* data, size_t size) const{
+        return find_pair_scalar(data, size, 0);
+    }
+    #endif
+
+    /**
+     * Find the first occurrence of the needle with the Boyer-Moore-Horspool algorithm.
+     * @param data The start of the buffer.
+     * @param size The size of the buffer.
+     * @return The index of the first occurrence, or string_view::npos if there isn't any.
+     */
+    size_t LiteralSearcher::find_horspool(const char* data, size_t size) const{
+        size_t last = needle.size() - 1;
+        auto last_byte = static_cast<ubyte>(needle.back());
+        for (size_t pos = 0; pos + last < size;){
+            auto chr = static_cast<ubyte>(data[pos + last]);
+            if (chr == last_byte && memcmp(data + pos, needle.data(), last) == 0){
+                return pos;
+            }
+            pos += shifts[chr];
+        }
+        return string_view::npos;
+    }
+
+    size_t LiteralSearcher::find(string_view buffer) const{
+        const char* data = buffer.data();
+        size_t size = buffer.size();
+        switch (kernel){
+            case EKernel::EMPTY:
+                return 0;
+            case EKernel::SINGLE_BYTE:
+            {
+                const void* found = memchr(data, needle.front(), size);
+                return found == nullptr ? string_view::npos : static_cast<const char*>(found) - data;
+            }
+            case EKernel::AVX2_PAIR:
+                return find_avx2(data, size);
+            case EKernel::SSE2_PAIR:
+                return find_sse2(data, size);
+            default:
+                return find_horspool(data, size);
+        }
+    }
+
+    bool LiteralSearcher::occurs_in(string_view buffer) const{
+        return find(buffer) != string_view::npos;
+    }
+
+    const string& LiteralSearcher::get_literal() const{
+        return needle;
+    }
+}
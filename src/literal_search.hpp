@@ -0,0 +1,81 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace cpp_grep{
+    using ubyte = uint8_t;
+
+    using std::array;
+    using std::string;
+    using std::string_view;
+
+    /**
+     * @brief Finds a single literal string in buffers.
+     *
+     * The kernel is picked once, when the searcher is built, based on the CPU and the literal's length:
+     * - one byte: memchr;
+     * - AVX2 or SSE2, up to MAX_PAIR_LENGTH bytes: the literal's first and last bytes are compared
+     *   against 32 or 16 positions at a time, and only positions where both match are checked with memcmp;
+     * - anything else: Boyer-Moore-Horspool, whose skips grow with the literal's length.
+     */
+    class LiteralSearcher{
+        public:
+            static constexpr size_t MAX_PAIR_LENGTH = 64;
+
+        private:
+            // The kernel used by this searcher.
+            enum class EKernel: ubyte{
+                EMPTY,
+                SINGLE_BYTE,
+                SSE2_PAIR,
+                AVX2_PAIR,
+                HORSPOOL,
+            };
+
+            string needle;
+            EKernel kernel{EKernel::EMPTY};
+            array<size_t, 256> shifts{};    // Horspool kernel: how far to move when a byte ends the window.
+
+            [[nodiscard]] bool matches_at(const char* data) const;
+            [[nodiscard]] size_t find_pair_scalar(const char* data, size_t size, size_t from) const;
+            [[nodiscard]] size_t find_sse2(const char* data, size_t size) const;
+            [[nodiscard]] size_t find_avx2(const char* data, size_t size) const;
+            [[nodiscard]] size_t find_horspool(const char* data, size_t size) const;
+
+        public:
+            /**
+             * Generate a searcher for the empty string, found at the start of any buffer.
+             */
+            LiteralSearcher() = default;
+
+            /**
+             * Build a searcher for the given literal.
+             * @param literal The literal to look for.
+             */
+            explicit LiteralSearcher(string literal);
+
+            /**
+             * @brief Find the first occurrence of the literal in a buffer.
+             * @param buffer The buffer to search.
+             * @return The index of the first occurrence, or string_view::npos if there isn't any.
+             */
+            [[nodiscard]] size_t find(string_view buffer) const;
+
+            /**
+             * @brief Check if a buffer contains the literal.
+             * @param buffer The buffer to search.
+             * @return true if the literal occurs in the buffer, false otherwise.
+             */
+            [[nodiscard]] bool occurs_in(string_view buffer) const;
+
+            [[nodiscard]] const string& get_literal() const;
+    };
+}
@@ -2,879 +2,616 @@
 // Created by fortwoone on 14/09/2025.
 //
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "matcher.hpp"
 
 namespace cpp_grep{
     namespace priv{
-        unordered_set<ECharClass> END_SEARCH_IF_EMPTY_AND_LAST_PAT = {
-            ECharClass::ZERO_OR_ONE,
-            ECharClass::PATTERN_MOST_ONE,
-            ECharClass::ANY_MOST_ONE,
-            ECharClass::END_ANCHOR
-        };
-    }
-
-    bool match_char(char input, const vector<RegexPatternPortion>& portions, uint& pattern_index){
-        if (pattern_index >= portions.size()){
-            return false;
-        }
-        const auto& portion = portions.at(pattern_index);
-
-        using enum ECharClass;
-        switch (portion.get_char_cls()){
-            case ANY:
-                pattern_index++;
-                return true;
-            case LITERAL:
-                cerr << "Portion literal: " << portion.get_literal() << "\n";
-                cerr << "Input character: " << input << "\n";
-                pattern_index++;
-                return input == portion.get_literal();
-            case DIGIT:
-                pattern_index++;
-                return priv::is_digit(input);
-            case WORD:
-                pattern_index++;
-                return priv::is_word(input);
-            case CHAR_GROUP:
-                pattern_index++;
-                if (portion.is_positive_grp()){
-                    return portion.get_char_grp().contains(input);
-                }
-                else {
-                    return !portion.get_char_grp().contains(input);
-                }
-            case END_ANCHOR:
-                return false;
-            default:
-                unreachable();
+        const string STDIN_PATH = "(standard input)";
+        constexpr size_t STREAM_BLOCK_SIZE = 1024 * 1024;  // 1 MiB
+        constexpr size_t CANCEL_CHECK_SIZE = 1024 * 1024;  // 1 MiB
+
+        /**
+         * Report statistics about a finished search, as info traces.
+         * @param dfa_flushes How many times the lazy DFA state caches were flushed during the search.
+         */
+        void log_matcher_stats(size_t dfa_flushes){
+            if (dfa_flushes > 0){
+                CPP_GREP_TRACE(INFO, "Lazy DFA cache flushed ", dfa_flushes, " time(s)");
+            }
         }
-    }
 
-    bool match_here(  // NOLINT
-        const string& input_line,
-        const vector<RegexPatternPortion>& portions,
-        uint input_index,
-        uint pattern_index,
-        BackRefManager& backref_texts,
-        RegexPatternPortion* next_outside_portion,
-        uint* processed
-    ){
-        if (pattern_index >= portions.size()){
-            return true;
+        /**
+         * Write a matched line to an output sink.
+         * The line itself is borrowed, so it must stay valid until the sink's borrowed data is released.
+         * @param output The sink to write to.
+         * @param path The path to the file the line is in.
+         * @param line The line to write.
+         * @param show_path Whether to write the path before the line.
+         * @param matched_pattern The pattern to write before the line, or nullptr to leave it out.
+         * It is borrowed as well, and belongs to the compiled pattern.
+         */
+        void append_line(OutputSink& output, const string& path, string_view line, bool show_path, const string* matched_pattern){
+            if (show_path){
+                output.write(path);
+                output.write(":");
+            }
+            if (matched_pattern != nullptr){
+                output.write_borrowed(*matched_pattern);
+                output.write(":");
+            }
+            output.write_borrowed(line);
+            output.write("\n");
+            output.end_line();
         }
 
-        const auto& portion = portions.at(pattern_index);
-
-        if (input_index >= input_line.size()){
-            return priv::END_SEARCH_IF_EMPTY_AND_LAST_PAT.contains(portion.get_char_cls());
+        /**
+         * Write a matched line to an output sink, once per matching pattern if asked to.
+         * @param output The sink to write to.
+         * @param path The path to the file the line is in.
+         * @param line The line to write. It is borrowed.
+         * @param show_path Whether to write the path before the line.
+         * @param matcher The matcher which matched the line, to write each matching pattern before it,
+         * or nullptr to write the line once without any pattern.
+         */
+        void append_match(OutputSink& output, const string& path, string_view line, bool show_path, LineMatcher* matcher){
+            if (matcher == nullptr){
+                append_line(output, path, line, show_path, nullptr);
+                return;
+            }
+            const auto& patterns = matcher->get_pattern().patterns;
+            for (uint index: matcher->collect_matched_patterns(line)){
+                append_line(output, path, line, show_path, &patterns[index]);
+            }
         }
 
-        if (portion.get_char_cls() == ECharClass::START_ANCHOR){
-            if (input_index > 0){
-                return false;
-            }
-            if (processed != nullptr){
-                (*processed)++;
+        /**
+         * Get how many matched lines a file can have before its search stops.
+         * @param options The search options.
+         * @return The limit set by SearchOptions::max_count, lowered to 1 when only the first matched line matters.
+         */
+        size_t line_limit(const SearchOptions& options){
+            if (options.output_mode == EOutputMode::FILES_WITH_MATCHES || options.output_mode == EOutputMode::QUIET){
+                return min<size_t>(options.max_count, 1);
             }
-            return match_here(
-                input_line,
-                portions,
-                input_index,
-                pattern_index + 1,
-                backref_texts
-            );
+            return options.max_count;
         }
 
-        uint check_pattern_idx = pattern_index;
-
-        switch (portion.get_char_cls()){
-            case ECharClass::ONE_OR_MORE:
-            {
-                // Handle matches separately.
-                uint count = 0;
-                while (input_line[input_index + count] == portion.get_literal()){
-                    count++;
-                }
-                if (!count) {
-                    // Fail if none were found.
-                    return false;
-                }
-                check_pattern_idx++;
-                if (portions.size() <= check_pattern_idx){
-                    return true;
-                }
-                else if (
-                    portions.at(check_pattern_idx).get_char_cls() == ECharClass::LITERAL
-                    && portions.at(check_pattern_idx).get_literal() == portion.get_literal()
-                    || next_outside_portion != nullptr
-                       && pattern_index == portions.size() - 1
-                       && next_outside_portion->get_char_cls() == ECharClass::LITERAL
-                       && next_outside_portion->get_literal() == portion.get_literal()
-                ){
-                    // Edge case: if a literal check is added with an identical literal
-                    // to the one used in this pattern portion, move the subindex backwards by one
-                    // so the literal check can still count as true.
-                    // Expanded to work if this is the last literal in a pattern so constant matches are interrupted.
-                    count--;
-                }
+        /**
+         * Check whether a search was cancelled.
+         * @param cancelled The search's cancellation flag, or nullptr if it can't be cancelled.
+         * @return true if the flag is set, false otherwise.
+         */
+        bool is_cancelled(const atomic<bool>* cancelled){
+            return cancelled != nullptr && cancelled->load(memory_order_relaxed);
+        }
 
-                if (processed != nullptr){
-                    (*processed) += count;
-                }
+        /**
+         * Get the part of a buffer searched before the cancellation flag is checked again.
+         * @param buffer The whole buffer.
+         * @param from Where the search resumes.
+         * @return The start of the buffer, up to the first newline at least CANCEL_CHECK_SIZE bytes past from (or its end).
+         */
+        string_view cancel_window(string_view buffer, size_t from){
+            if (buffer.size() - from <= CANCEL_CHECK_SIZE){
+                return buffer;
+            }
+            const void* newline = memchr(buffer.data() + from + CANCEL_CHECK_SIZE, '\n', buffer.size() - from - CANCEL_CHECK_SIZE);
+            if (newline == nullptr){
+                return buffer;
+            }
+            return buffer.substr(0, static_cast<const char*>(newline) - buffer.data() + 1);
+        }
 
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + count,
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
-                );
-            }
-            case ECharClass::ZERO_OR_ONE:
-            {
-                // Handle matches separately.
-                uint count = 0;
-                while (input_line[input_index + count] == portion.get_literal()){
-                    count++;
-                    if (count > 1){
-                        // More than one occurrence? No match.
-                        return false;
+        /**
+         * Collect the matched lines of a buffer, up to a limit. Only SearchOptions::output_mode LINES writes them.
+         * @param path The path to the file, as written before matched lines.
+         * @param buffer The lines to search.
+         * @param matcher The compiled pattern.
+         * @param options The search options.
+         * @param show_path Whether to write the file's path before each matched line.
+         * @param limit How many matched lines to stop after.
+         * @param output The sink matched lines are written to. Lines are borrowed from the buffer.
+         * @param cancelled If given, the search stops (early, but not right away) once it is set.
+         * @return How many lines were matched.
+         */
+        size_t search_lines(const string& path, string_view buffer, LineMatcher& matcher, const SearchOptions& options, bool show_path, size_t limit, OutputSink& output, const atomic<bool>* cancelled){
+            size_t count = 0;
+            bool print_lines = options.output_mode == EOutputMode::LINES;
+            bool show_pattern = options.show_pattern && matcher.get_pattern().patterns.size() > 1;
+            string_view line;
+            size_t from = 0;
+            if (limit == 0){
+                return 0;
+            }
+            if (!options.whole_buffer){
+                while (from < buffer.size() && !is_cancelled(cancelled)){
+                    size_t end = buffer.find('\n', from);
+                    if (end == string_view::npos){
+                        end = buffer.size();
                     }
-                }
-                if (processed != nullptr){
-                    (*processed) += count;
-                }
-                check_pattern_idx++;
-                if (portions.size() <= check_pattern_idx){
-                    return true;
-                }
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + count,
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
-                );
-            }
-            case ECharClass::DIGIT_MOST_ONE:
-            {
-                uint count = 0;
-                while (priv::is_digit(input_line[input_index + count])){
-                    count++;
-                    if (count > 1){
-                        return false;
+                    line = buffer.substr(from, end - from);
+                    CPP_GREP_TRACE(DEBUG, "Current line (", path, "): ", line);
+                    if (matcher.matches(line)){
+                        if (print_lines){
+                            append_match(output, path, line, show_path, show_pattern ? &matcher : nullptr);
+                        }
+                        if (++count == limit){
+                            break;
+                        }
                     }
+                    from = end + 1;
                 }
-
-                if (processed != nullptr){
-                    (*processed) += count;
-                }
-
-                check_pattern_idx++;
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + count,
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
-                );
+                return count;
             }
-            case ECharClass::DIGIT_LEAST_ONE:
-            {
-                uint count = 0;
-                while (priv::is_digit(input_line[input_index + count])){
-                    count++;
-                }
 
-                if (!count){
-                    return false;
+            string_view window = buffer;
+            while (!is_cancelled(cancelled)){
+                if (cancelled != nullptr){
+                    // Search in slices, so that a cancelled search doesn't go through the rest of a large file.
+                    window = cancel_window(buffer, from);
                 }
-
-                if (processed != nullptr){
-                    (*processed) += count;
-                }
-
-                check_pattern_idx++;
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + count,
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
-                );
-            }
-            case ECharClass::WORD_MOST_ONE:
-            {
-                uint count = 0;
-                while (priv::is_word(input_line[input_index + count])){
-                    count++;
-                    if (count > 1){
-                        return false;
+                if (!matcher.find_matching_line(window, from, line)){
+                    if (window.size() == buffer.size()){
+                        break;
                     }
+                    from = window.size();
+                    continue;
                 }
-
-                if (processed != nullptr){
-                    (*processed) += count;
-                }
-
-                check_pattern_idx++;
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + count,
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
-                );
-            }
-            case ECharClass::WORD_LEAST_ONE:
-            {
-                uint count = 0;
-                while (priv::is_word(input_line[input_index + count])){
-                    count++;
-                }
-
-                if (!count){
-                    return false;
+                CPP_GREP_TRACE(DEBUG, "Matched line (", path, "): ", line);
+                if (print_lines){
+                    append_match(output, path, line, show_path, show_pattern ? &matcher : nullptr);
                 }
-
-                if (processed != nullptr){
-                    (*processed) += count;
+                if (++count == limit){
+                    break;
                 }
-
-                check_pattern_idx++;
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + count,
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
-                );
+                from = static_cast<size_t>(line.data() - buffer.data()) + line.size() + 1;
             }
-            case ECharClass::CHAR_GROUP_MOST_ONE:
-            {
-                uint i = 0;
-                bool is_positive = portion.is_positive_grp();
-                const auto& char_grp = portion.get_char_grp();
-                if (is_positive){
-                    while ((input_index + i) < input_line.size() && char_grp.contains(input_line[input_index + i])){
-                        i++;
-                        if (i > 1){
-                            return false;
-                        }
+            return count;
+        }
+
+        /**
+         * Write what the output mode prints about a whole file, once it was searched.
+         * @param output The sink to write to.
+         * @param path The path to the file.
+         * @param count How many lines of the file were matched.
+         * @param options The search options.
+         * @param show_path Whether to write the path before the count, in COUNT mode.
+         */
+        void report_file(OutputSink& output, const string& path, size_t count, const SearchOptions& options, bool show_path){
+            switch (options.output_mode){
+                case EOutputMode::COUNT:
+                    if (show_path){
+                        output.write(path);
+                        output.write(":");
                     }
-                }
-                else{
-                    while ((input_index + i) < input_line.size() && !char_grp.contains(input_line[input_index + i])){
-                        i++;
-                        if (i > 1){
-                            return false;
-                        }
+                    output.write(to_string(count));
+                    output.write("\n");
+                    output.end_line();
+                    break;
+                case EOutputMode::FILES_WITH_MATCHES:
+                    if (count > 0){
+                        output.write(path);
+                        output.write("\n");
+                        output.end_line();
                     }
-                }
+                    break;
+                case EOutputMode::LINES:
+                case EOutputMode::QUIET:
+                    break;
+            }
+        }
 
-                if (processed != nullptr){
-                    (*processed) += i;
-                }
-                check_pattern_idx++;
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + i,
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
-                );
+        bool search_buffer(const string& path, string_view buffer, LineMatcher& matcher, const SearchOptions& options, bool show_path, OutputSink& output, const atomic<bool>* cancelled){
+            size_t count = search_lines(path, buffer, matcher, options, show_path, line_limit(options), output, cancelled);
+            report_file(output, path, count, options, show_path);
+            return count > 0;
+        }
+
+        bool search_file(const string& path, LineMatcher& matcher, FileReader& reader, const SearchOptions& options, bool show_path, OutputSink& output, const atomic<bool>* cancelled){
+            string_view buffer;
+            if (is_cancelled(cancelled) || !reader.open(path, buffer)){
+                return false;
             }
-            case ECharClass::CHAR_GROUP_LEAST_ONE:
-            {
-                uint i = 0;
+            return search_buffer(path, buffer, matcher, options, show_path, output, cancelled);
+        }
 
-                bool is_positive = portion.is_positive_grp();
-                const auto& char_grp = portion.get_char_grp();
+        /**
+         * @brief Everything a thread needs to search files on its own.
+         */
+        struct SearchWorker{
+            LineMatcher matcher;
+            FileReader reader;
+            OutputSink output;  // Held in memory until handed over to the collector.
 
-                if (is_positive){
-                    while ((input_index + i) < input_line.size() && char_grp.contains(input_line[input_index + i])){
-                        i++;
+            SearchWorker(const CompiledPattern& pattern, const SearchOptions& options)
+            : matcher(pattern, options), reader(options.mmap_threshold){
+            }
+        };
+
+        /**
+         * @brief Prints the output of files searched concurrently.
+         *
+         * Each file's output is printed at once, so lines from different files never interleave.
+         * In ordered mode, outputs are held back until the outputs of every previous file were printed.
+         */
+        class OutputCollector{
+            mutex lock;
+            OutputSink& sink;
+            bool ordered;
+            vector<string> held_outputs;
+            vector<bool> finished;
+            size_t next_to_print{0};
+
+            public:
+                /**
+                 * Create a collector.
+                 * @param sink The sink outputs are printed to.
+                 * @param file_count The amount of files searched.
+                 * @param ordered Whether outputs have to be printed in the same order as the files.
+                 */
+                OutputCollector(OutputSink& sink, size_t file_count, bool ordered): sink(sink), ordered(ordered){
+                    if (ordered){
+                        held_outputs.resize(file_count);
+                        finished.resize(file_count, false);
                     }
                 }
-                else{
-                    if (
-                        next_outside_portion != nullptr
-                        && pattern_index == portions.size() - 1
-                        && next_outside_portion->get_char_cls() == ECharClass::LITERAL
-                    ){
-                        char next_chr = next_outside_portion->get_literal();
-                        while (
-                            (input_index + i) < input_line.size()
-                            && !char_grp.contains(input_line[input_index + i])
-                            && input_line[input_index + i] != next_chr
-                        ){
-                            i++;
+
+                /**
+                 * Hand over the output of a searched file.
+                 * @param file_index The file's index in the searched list.
+                 * @param output The file's output. It is emptied.
+                 */
+                void add(size_t file_index, OutputSink& output){
+                    lock_guard guard(lock);
+                    if (!ordered){
+                        if (!output.empty()){
+                            output.move_to(sink);
+                            sink.end_line();
                         }
+                        return;
                     }
-                    else {
-                        while (
-                            (input_index + i) < input_line.size()
-                            && !char_grp.contains(input_line[input_index + i])
-                        ){
-                            i++;
+                    output.move_to(held_outputs[file_index]);
+                    finished[file_index] = true;
+                    while (next_to_print < finished.size() && finished[next_to_print]){
+                        if (!held_outputs[next_to_print].empty()){
+                            sink.write(held_outputs[next_to_print]);
+                            sink.end_line();
                         }
+                        string().swap(held_outputs[next_to_print]);
+                        next_to_print++;
                     }
                 }
+        };
 
-                if (i < 1){
-                    return false;
-                }
+        /**
+         * Create the per-thread state of a concurrent search.
+         * @param thread_count The amount of worker threads.
+         * @param pattern The compiled pattern, shared by every worker.
+         * @param options The search options.
+         * @return One worker state per thread.
+         */
+        vector<unique_ptr<SearchWorker>> make_workers(uint thread_count, const CompiledPattern& pattern, const SearchOptions& options){
+            vector<unique_ptr<SearchWorker>> workers;
+            workers.reserve(thread_count);
+            for (uint i = 0; i < thread_count; ++i){
+                workers.push_back(make_unique<SearchWorker>(pattern, options));
+            }
+            return workers;
+        }
 
-                if (processed != nullptr){
-                    (*processed) += i;
-                }
-                check_pattern_idx++;
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + i,
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
-                );
-            }
-            case ECharClass::ANY_LEAST_ONE:
+        /**
+         * Get how many times the lazy DFA caches of a concurrent search's workers were flushed.
+         * @param workers The workers.
+         * @return The total amount of cache flushes.
+         */
+        size_t sum_dfa_flushes(const vector<unique_ptr<SearchWorker>>& workers){
+            size_t dfa_flushes = 0;
+            for (const auto& worker: workers){
+                dfa_flushes += worker->matcher.get_dfa_flush_count();
+            }
+            return dfa_flushes;
+        }
+
+        /**
+         * Search files on a work-stealing pool, each worker thread using its own matcher and output buffer.
+         * @param files The paths to the files to search.
+         * @param pattern The compiled pattern, shared by every worker.
+         * @param options The search options.
+         * @return true if any line of any file was matched, false otherwise.
+         */
+        bool search_files_parallel(const vector<string>& files, const CompiledPattern& pattern, const SearchOptions& options){
+            auto thread_count = static_cast<uint>(min<size_t>(options.thread_count, files.size()));
+            vector<unique_ptr<SearchWorker>> workers = make_workers(thread_count, pattern, options);
+
+            OutputSink sink = make_stdout_sink();
+            OutputCollector collector(sink, files.size(), options.ordered_output);
+            atomic<bool> success{false};
+            // In quiet mode, the first matched line settles the search: every worker stops once it is found.
+            const atomic<bool>* cancelled = options.output_mode == EOutputMode::QUIET ? &success : nullptr;
             {
-                if (pattern_index + 1 >= portions.size()){
-                    return true;
-                }
-                else if (
-                    portions.at(pattern_index + 1).get_char_cls() == ECharClass::LITERAL
-                ){
-                    char next_literal = portions.at(pattern_index + 1).get_literal();
-                    uint count = 0;
-                    while (input_line[input_index + count] != next_literal && (input_index + count) < input_line.size()){
-                        count++;
-                    }
-                    if (!count){
-                        return false;
-                    }
-                    check_pattern_idx++;
-                    return match_here(
-                        input_line,
-                        portions,
-                        input_index + count,
-                        check_pattern_idx,
-                        backref_texts,
-                        next_outside_portion,
-                        processed
-                    );
-                }
-                else{
-                    uint count = 0;
-                    while (!match_here(input_line, portions, input_index + count + 1, pattern_index + 1, backref_texts, next_outside_portion, processed)){
-                        count++;
-                        if (input_index + count + 1 >= input_line.size()){
-                            break;
+                WorkStealingPool pool(thread_count);
+                for (size_t i = 0; i < files.size(); ++i){
+                    pool.submit(
+                        [&files, &workers, &options, &collector, &success, cancelled, i](uint worker_index){
+                            SearchWorker& worker = *workers[worker_index];
+                            if (search_file(files[i], worker.matcher, worker.reader, options, true, worker.output, cancelled)){
+                                success.store(true, memory_order_relaxed);
+                            }
+                            collector.add(i, worker.output);
                         }
-                    }
-                    if (!count){
-                        return false;
-                    }
-                    check_pattern_idx++;
-                    return match_here(
-                        input_line,
-                        portions,
-                        input_index + count + 1,
-                        check_pattern_idx,
-                        backref_texts,
-                        next_outside_portion,
-                        processed
                     );
                 }
+                pool.wait();
             }
-            case ECharClass::OR:
-            {
-                const auto& pattern1 = portion.get_subpattern1();
-                const auto& pattern2 = portion.get_subpattern2();
-                uint count_a = 0;
-                uint count_b = 0;
-                if (match_here(input_line, pattern1, input_index, 0, backref_texts, nullptr, &count_a)){
-                    if (processed != nullptr){
-                        (*processed) += count_a;
-                    }
-                    return true;
-                }
-                if (match_here(input_line, pattern2, input_index, 0, backref_texts, nullptr, &count_b)){
-                    if (processed != nullptr){
-                        (*processed) += count_b;
+
+            log_matcher_stats(sum_dfa_flushes(workers));
+            return success.load();
+        }
+
+        /**
+         * Split a buffer into chunks of about the given size, each one ending right after a newline (except the last one).
+         * @param buffer The buffer to split.
+         * @param chunk_size The minimum size of each chunk but the last. Must not be 0.
+         * @return The chunks, in the buffer's order. Together, they cover the whole buffer.
+         */
+        vector<string_view> split_chunks(string_view buffer, size_t chunk_size){
+            vector<string_view> chunks;
+            size_t start = 0;
+            while (start < buffer.size()){
+                size_t end = buffer.size();
+                if (buffer.size() - start > chunk_size){
+                    const void* newline = memchr(buffer.data() + start + chunk_size, '\n', buffer.size() - start - chunk_size);
+                    if (newline != nullptr){
+                        end = static_cast<const char*>(newline) - buffer.data() + 1;
                     }
-                    return true;
-                }
-                if (processed != nullptr){
-                    (*processed)++;
                 }
-                return false;
+                chunks.push_back(buffer.substr(start, end - start));
+                start = end;
             }
-            case ECharClass::PATTERN:
-            {
-                uint count = 0;
-                ubyte reserved_slot = backref_texts.reserve_first_free_slot();
-                RegexPatternPortion* next_outside = nullptr;
-                if (pattern_index + 1 < portions.size()){
-                    next_outside = const_cast<RegexPatternPortion*>(portions.data()) + pattern_index + 1;
-                }
-                if (!match_here(input_line, portion.get_subpattern(), input_index, 0, backref_texts, next_outside, &count)){
-                    return false;
-                }
-                next_outside = nullptr;
-                check_pattern_idx++;
-                if (processed != nullptr){
-                    (*processed) += count;
-                }
+            return chunks;
+        }
 
-                // Attempt to save the matched text into the backreference list for later use.
-                // Find the first empty string inside, and replace it with the text if there is indeed an empty string.
-                backref_texts.set_text_at(reserved_slot, input_line.substr(input_index, count));
-
-                input_index += count - 1;
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + 1,
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
-                );
-            }
-            case ECharClass::PATTERN_MOST_ONE:
+        /**
+         * Search the chunks of a file's contents on a work-stealing pool, each worker thread using its own matcher.
+         * Results are reordered so that they are written in the file's order.
+         * @param path The path to the file, as written before matched lines.
+         * @param chunks The file's contents, split at line boundaries.
+         * @param pattern The compiled pattern, shared by every worker.
+         * @param options The search options.
+         * @param show_path Whether to write the file's path before each matched line.
+         * @param output The sink results are written to.
+         * @return How many lines of the chunks were matched.
+         */
+        size_t search_chunks_parallel(const string& path, const vector<string_view>& chunks, const CompiledPattern& pattern, const SearchOptions& options, bool show_path, OutputSink& output){
+            auto thread_count = static_cast<uint>(min<size_t>(options.thread_count, chunks.size()));
+            vector<unique_ptr<SearchWorker>> workers = make_workers(thread_count, pattern, options);
+
+            OutputCollector collector(output, chunks.size(), true);
+            atomic<size_t> count{0};
             {
-                uint count = 0;
-                uint processed_chrs = 0;
-                uint processed_tot = 0;
-                ubyte reserved_slot = backref_texts.reserve_first_free_slot();
-                while (match_here(input_line, portion.get_subpattern(), input_index + processed_tot, 0, backref_texts, next_outside_portion, &processed_chrs)){
-                    count++;
-                    processed_tot += processed_chrs;
-                    processed_chrs = 0;
-                }
-                if (count > 1){
-                    return false;
-                }
-                if (processed_chrs > 0 && processed_tot == 0){
-                    processed_tot += processed_chrs;
-                }
-                if (processed != nullptr){
-                    (*processed) += processed_tot;
+                WorkStealingPool pool(thread_count);
+                for (size_t i = 0; i < chunks.size(); ++i){
+                    pool.submit(
+                        [&path, &chunks, &workers, &options, &collector, &count, show_path, i](uint worker_index){
+                            SearchWorker& worker = *workers[worker_index];
+                            count.fetch_add(
+                                search_lines(path, chunks[i], worker.matcher, options, show_path, NO_MAX_COUNT, worker.output, nullptr),
+                                memory_order_relaxed
+                            );
+                            collector.add(i, worker.output);
+                        }
+                    );
                 }
-
-                // Attempt to save the matched text into the backreference list for later use.
-                // Find the first empty string inside, and replace it with the text if there is indeed an empty string.
-                backref_texts.set_text_at(reserved_slot, input_line.substr(input_index, processed_tot));
-
-                check_pattern_idx++;
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + processed_tot,
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
-                );
+                pool.wait();
             }
-            case ECharClass::PATTERN_LEAST_ONE:
-            {
-                uint count = 0;
-                uint processed_chrs = 0;
-                uint processed_tot = 0;
-                ubyte reserved_slot = backref_texts.reserve_first_free_slot();
-                while (match_here(input_line.substr(input_index + processed_tot), portion.get_subpattern(), 0, 0, backref_texts, next_outside_portion, &processed_chrs)){
-                    count++;
-                    processed_tot += processed_chrs;
-                    processed_chrs = 0;
-                }
-                if (count < 1){
-                    return false;
-                }
-                if (processed_chrs > 0 && processed_tot == 0){
-                    processed_tot += processed_chrs;
-                }
-                if (processed != nullptr){
-                    (*processed) += processed_tot;
-                }
 
-                if (processed_tot > 0){
-                    // Attempt to save the matched text into the backreference list for later use.
-                    // Find the first empty string inside, and replace it with the text if there is indeed an empty string.
-                    backref_texts.set_text_at(reserved_slot, input_line.substr(input_index, processed_tot));
-                }
-                else{
-                    backref_texts.free_at(reserved_slot);
-                }
+            log_matcher_stats(sum_dfa_flushes(workers));
+            return count.load();
+        }
 
-                check_pattern_idx++;
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + 1 + processed_tot,
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
-                );
-            }
-            case ECharClass::BACKREFERENCE:
-            {
-                ubyte backref_index = portion.get_backref_index();
-                const auto& txt = backref_texts.get_text_at(backref_index);
+        /**
+         * Collect the matched lines of a buffer, up to a limit, splitting large buffers across threads.
+         * Buffers are only split when every line has to be searched: with a limit, the search stops early instead.
+         * @param path The path to the file, as written before matched lines.
+         * @param buffer The lines to search.
+         * @param matcher The compiled pattern, used for small buffers.
+         * @param options The search options.
+         * @param show_path Whether to write the file's path before each matched line.
+         * @param limit How many matched lines to stop after.
+         * @param output The sink matched lines are written to. Lines may be borrowed from the buffer.
+         * @return How many lines were matched.
+         */
+        size_t search_lines_chunked(const string& path, string_view buffer, LineMatcher& matcher, const SearchOptions& options, bool show_path, size_t limit, OutputSink& output){
+            if (options.thread_count < 2 || options.chunk_size == 0 || buffer.size() / 2 < options.chunk_size || limit != NO_MAX_COUNT){
+                return search_lines(path, buffer, matcher, options, show_path, limit, output, nullptr);
+            }
+            CPP_GREP_TRACE(INFO, "Splitting ", path, " into chunks of ", options.chunk_size, " bytes");
+            return search_chunks_parallel(path, split_chunks(buffer, options.chunk_size), matcher.get_pattern(), options, show_path, output);
+        }
 
-                if (input_line.substr(input_index, txt.size()) != txt){
-                    return false;
-                }
-                if (processed != nullptr){
-                    (*processed) += txt.size();
-                }
+        bool search_buffer_chunked(const string& path, string_view buffer, LineMatcher& matcher, const SearchOptions& options, bool show_path, OutputSink& output){
+            size_t count = search_lines_chunked(path, buffer, matcher, options, show_path, line_limit(options), output);
+            report_file(output, path, count, options, show_path);
+            return count > 0;
+        }
 
-                check_pattern_idx++;
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + txt.size(),
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
-                );
+        bool search_file_chunked(const string& path, LineMatcher& matcher, FileReader& reader, const SearchOptions& options, bool show_path, OutputSink& output){
+            string_view buffer;
+            if (!reader.open(path, buffer)){
+                return false;
             }
-            case ECharClass::BACKREF_LEAST_ONE:
-            {
-                ubyte backref_index = portion.get_backref_index() - 1;
-                const auto& txt = backref_texts.get_text_at(backref_index);
-                size_t txt_size = txt.size();
-                uint count = 0;
-
-                while (input_line.substr(input_index + count * txt_size, txt_size) == txt){
-                    count++;
-                }
-                if (!count){
-                    return false;
-                }
-
-                if (processed != nullptr){
-                    (*processed) += count * txt_size;
-                }
+            return search_buffer_chunked(path, buffer, matcher, options, show_path, output);
+        }
 
-                check_pattern_idx++;
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + count * txt_size,
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
-                );
+        /**
+         * Get the size of the blocks the standard input is streamed in.
+         * @param options The search options.
+         * @return Enough for each thread to get a chunk if there are several, STREAM_BLOCK_SIZE otherwise.
+         */
+        size_t stream_block_size(const SearchOptions& options){
+            if (options.thread_count > 1 && options.chunk_size > 0){
+                return options.thread_count * options.chunk_size;
             }
-            case ECharClass::BACKREF_MOST_ONE:
-            {
-                ubyte backref_index = portion.get_backref_index() - 1;
-                const auto& txt = backref_texts.get_text_at(backref_index);
-                size_t txt_size = txt.size();
-                uint count = 0;
-
-                while (input_line.substr(input_index + count * txt_size, txt_size) == txt){
-                    count++;
-                    if (count > 1){
-                        return false;
-                    }
-                }
-
-                if (processed != nullptr){
-                    (*processed) += count * txt_size;
-                }
+            return STREAM_BLOCK_SIZE;
+        }
 
-                check_pattern_idx++;
-                return match_here(
-                    input_line,
-                    portions,
-                    input_index + count * txt_size,
-                    check_pattern_idx,
-                    backref_texts,
-                    next_outside_portion,
-                    processed
+        /**
+         * Search a directory tree on a work-stealing pool, directories being read concurrently with the search.
+         * Results are printed in no particular order.
+         * @param directory The root of the tree.
+         * @param pattern The compiled pattern, shared by every worker.
+         * @param options The search options.
+         * @return true if any line of any file was matched, false otherwise.
+         * @throw runtime_error if the directory can't be opened.
+         */
+        bool search_directory_parallel(const string& directory, const CompiledPattern& pattern, const SearchOptions& options){
+            vector<unique_ptr<SearchWorker>> workers = make_workers(options.thread_count, pattern, options);
+
+            OutputSink sink = make_stdout_sink();
+            OutputCollector collector(sink, 0, false);
+            atomic<bool> success{false};
+            // In quiet mode, the first matched line stops both the walk and the workers.
+            const atomic<bool>* cancelled = options.output_mode == EOutputMode::QUIET ? &success : nullptr;
+            {
+                WorkStealingPool pool(options.thread_count);
+                walk_directory_parallel(
+                    directory,
+                    pool,
+                    [&workers, &options, &collector, &success, cancelled](const WalkedDir& dir, const char* name, uint worker_index){
+                        SearchWorker& worker = *workers[worker_index];
+                        string_view buffer;
+                        if (!worker.reader.open_at(dir.get_fd(), name, buffer)){
+                            return;
+                        }
+                        if (search_buffer(dir.join(name), buffer, worker.matcher, options, true, worker.output, cancelled)){
+                            success.store(true, memory_order_relaxed);
+                        }
+                        collector.add(0, worker.output);
+                    },
+                    cancelled
                 );
             }
-            default:
-                break;
-        }
-
-        if (!match_char(input_line[input_index], portions, check_pattern_idx)){
-            return false;
-        }
 
-        if (processed != nullptr){
-            (*processed)++;
+            log_matcher_stats(sum_dfa_flushes(workers));
+            return success.load();
         }
-
-        return match_here(
-            input_line,
-            portions,
-            input_index + 1,
-            check_pattern_idx,
-            backref_texts,
-            next_outside_portion,
-            processed
-        );
     }
 
-    bool match_pattern(const string& input_line, const string& pattern){
-        if (pattern.length() == 1) {
-            return input_line.find(pattern) != string::npos;
-        }
-        else if (pattern == priv::DIGIT_CLS_PATTERN){
-            // Handle digit class.
-            return match_digit_pattern(input_line);
-        }
-        else if (pattern == priv::WORD_CLS_PATTERN){
-            // Handle word class.
-            return match_word_pattern(input_line);
-        }
-        else if (pattern.starts_with('[') && pattern.ends_with(']')){
-            // Character group
-            // Don't count the brackets while searching, they simply delimit the group itself.
-            auto stripped_pattern = pattern.substr(1, pattern.size() - 2);
-            if (stripped_pattern.starts_with('^')){
-                // Negative character group
-                return match_negative_character_grp(input_line, stripped_pattern.substr(1));
-            }
-            // Positive character group otherwise.
-            return match_positive_character_grp(input_line, stripped_pattern);
-        }
-        else if (pattern.length() > 1){
-            uint caught_grp_count = 0;
-            vector<RegexPatternPortion> portions = extract_patterns(pattern, caught_grp_count);
-            BackRefManager backref_texts(caught_grp_count);
-            for (size_t start = 0; start <= input_line.size(); ++start){
-                if (match_here(input_line, portions, start, 0, backref_texts)){
-                    return true;
-                }
-                backref_texts.reset();
-            }
-            return false;
-        }
-        else {
-            throw runtime_error("Unhandled pattern " + pattern);
-        }
+    bool match_pattern(const string& input_line, const vector<string>& patterns, const SearchOptions& options){
+        CompiledPattern compiled(patterns, options.fixed_strings);
+        LineMatcher matcher(compiled, options);
+        bool success = matcher.matches(input_line);
+        priv::log_matcher_stats(matcher.get_dfa_flush_count());
+        return success;
     }
 
-    bool match_in_file(const string& file, const string& pattern){
-        ifstream file_obj(file);
-        string input_line;
+    bool match_stdin(const vector<string>& patterns, const SearchOptions& options){
+        CompiledPattern compiled(patterns, options.fixed_strings);
+        LineMatcher matcher(compiled, options);
+        // Declared before the sink, which may still borrow lines from it when flushed.
+        FileReader reader(options.mmap_threshold);
+        OutputSink output = make_stdout_sink();
         bool success = false;
-        if (pattern.length() == 1) {
-            while (getline(file_obj, input_line)){
-                if (input_line.contains(pattern)){
-                    success = true;
-                    cout << input_line << "\n";
-                }
-            }
-            return success;
-        }
-        else if (pattern == priv::DIGIT_CLS_PATTERN){
-            // Handle digit class.
-            while (getline(file_obj, input_line)){
-                if (match_digit_pattern(input_line)){
-                    success = true;
-                    cout << input_line << "\n";
-                }
-            }
-            return success;
-        }
-        else if (pattern == priv::WORD_CLS_PATTERN){
-            // Handle word class.
-            while (getline(file_obj, input_line)){
-                if (match_word_pattern(input_line)){
-                    success = true;
-                    cout << input_line << "\n";
-                }
-            }
-            return success;
-        }
-        else if (pattern.starts_with('[') && pattern.ends_with(']')){
-            // Character group
-            // Don't count the brackets while searching, they simply delimit the group itself.
-            auto stripped_pattern = pattern.substr(1, pattern.size() - 2);
-            if (stripped_pattern.starts_with('^')){
-                // Negative character group
-                while (getline(file_obj, input_line)){
-                    if (match_negative_character_grp(input_line, stripped_pattern.substr(1))){
-                        success = true;
-                        cout << input_line << "\n";
-                    }
-                }
-                return success;
-            }
-            // Positive character group otherwise.
-            while (getline(file_obj, input_line)){
-                if (match_positive_character_grp(input_line, stripped_pattern)){
-                    success = true;
-                    cout << input_line << "\n";
-                }
-            }
-            return success;
-        }
-        else if (pattern.length() > 1){
-            uint caught_grp_count = 0;
-            vector<RegexPatternPortion> portions = extract_patterns(pattern, caught_grp_count);
-            BackRefManager backref_texts(caught_grp_count);
-            while (getline(file_obj, input_line)){
-                for (size_t start = 0; start <= input_line.size(); ++start){
-                    if (match_here(input_line, portions, start, 0, backref_texts)){
-                        success = true;
-                        cout << input_line << "\n";
-                        backref_texts.reset();
-                        break;
-                    }
-                    backref_texts.reset();
-                }
-            }
-            return success;
+
+        struct stat info{};
+        if (fstat(STDIN_FILENO, &info) == 0 && S_ISREG(info.st_mode)){
+            // A redirected file can be mapped, and split across threads, like any other.
+            string_view buffer;
+            success = reader.open_fd(STDIN_FILENO, buffer)
+                && priv::search_buffer_chunked(priv::STDIN_PATH, buffer, matcher, options, false, output);
         }
-        else {
-            throw runtime_error("Unhandled pattern " + pattern);
+        else{
+            StreamReader stream(STDIN_FILENO, priv::stream_block_size(options));
+            size_t limit = priv::line_limit(options);
+            size_t count = 0;
+            string_view lines;
+            // Once the limit is reached, the rest of the stream is left unread.
+            while (count < limit && stream.next(lines)){
+                // Without a limit, blocks may still be split across threads.
+                size_t remaining = limit == priv::NO_MAX_COUNT ? priv::NO_MAX_COUNT : limit - count;
+                count += priv::search_lines_chunked(priv::STDIN_PATH, lines, matcher, options, false, remaining, output);
+                // Matched lines point into a block the stream is about to reuse.
+                output.release_borrowed();
+            }
+            priv::report_file(output, priv::STDIN_PATH, count, options, false);
+            success = count > 0;
         }
+        priv::log_matcher_stats(matcher.get_dfa_flush_count());
+        return success;
     }
 
-    bool match_in_files(const vector<string>& files, const string& pattern){
-        bool success = false;
-        string input_line;
-        if (pattern.length() == 1){
-            for (const auto& path: files){
-                ifstream file_obj(path);
-
-                while (getline(file_obj, input_line)){
-                    if (input_line.contains(pattern)){
-                        success = true;
-                        cout << path << ":" << input_line << "\n";
-                    }
-                }
-
-                file_obj.close();
-            }
-            return success;
-        }
-        else if (pattern == priv::DIGIT_CLS_PATTERN){
-            // Handle digit class.
-            for (const auto& path: files){
-                ifstream file_obj(path);
-
-                while (getline(file_obj, input_line)){
-                    if (match_digit_pattern(input_line)){
-                        success = true;
-                        cout << path << ":" << input_line << "\n";
-                    }
-                }
+    bool match_in_file(const string& file, const vector<string>& patterns, const SearchOptions& options){
+        CompiledPattern compiled(patterns, options.fixed_strings);
+        LineMatcher matcher(compiled, options);
+        FileReader reader(options.mmap_threshold);
+        OutputSink output = make_stdout_sink();
+        bool success = priv::search_file_chunked(file, matcher, reader, options, false, output);
+        priv::log_matcher_stats(matcher.get_dfa_flush_count());
+        return success;
+    }
 
-                file_obj.close();
-            }
-            return success;
+    bool match_in_files(const vector<string>& files, const vector<string>& patterns, const SearchOptions& options){
+        CompiledPattern compiled(patterns, options.fixed_strings);
+        if (options.thread_count > 1 && files.size() > 1){
+            return priv::search_files_parallel(files, compiled, options);
         }
-        else if (pattern == priv::WORD_CLS_PATTERN){
-            // Handle word class.
-            for (const auto& path: files){
-                ifstream file_obj(path);
-
-                while (getline(file_obj, input_line)){
-                    if (match_word_pattern(input_line)){
-                        success = true;
-                        cout << path << ":" << input_line << "\n";
-                    }
-                }
 
-                file_obj.close();
+        LineMatcher matcher(compiled, options);
+        FileReader reader(options.mmap_threshold);
+        OutputSink output = make_stdout_sink();
+        bool success = false;
+        for (const auto& path: files){
+            // With several threads, this is only reached for a single file: split it instead.
+            success = priv::search_file_chunked(path, matcher, reader, options, true, output) || success;
+            // Matched lines point into the file's contents, which the next file replaces.
+            output.release_borrowed();
+            if (success && options.output_mode == EOutputMode::QUIET){
+                break;
             }
-            return success;
         }
-        else if (pattern.starts_with('[') && pattern.ends_with(']')){
-            // Character group
-            // Don't count the brackets while searching, they simply delimit the group itself.
-            auto stripped_pattern = pattern.substr(1, pattern.size() - 2);
-            if (stripped_pattern.starts_with('^')){
-                // Negative character group
-                for (const auto& path: files){
-                    ifstream file_obj(path);
-
-                    while (getline(file_obj, input_line)) {
-                        if (match_negative_character_grp(input_line, stripped_pattern.substr(1))) {
-                            success = true;
-                            cout << path << ":" << input_line << "\n";
-                        }
-                    }
+        priv::log_matcher_stats(matcher.get_dfa_flush_count());
+        return success;
+    }
 
-                    file_obj.close();
-                }
-                return success;
+    bool match_in_directory_recursive(const string& directory, const vector<string>& patterns, const SearchOptions& options){
+        CompiledPattern compiled(patterns, options.fixed_strings);
+        if (options.thread_count > 1){
+            if (!options.ordered_output){
+                return priv::search_directory_parallel(directory, compiled, options);
             }
-            // Positive character group otherwise.
-            for (const auto& path: files){
-                ifstream file_obj(path);
-                while (getline(file_obj, input_line)) {
-                    if (match_positive_character_grp(input_line, stripped_pattern)) {
-                        success = true;
-                        cout << path << ":" << input_line << "\n";
-                    }
+            // Results have to follow the walk's order, so list the files up front.
+            vector<string> file_paths;
+            walk_directory(
+                directory,
+                [&file_paths](const WalkedDir& dir, const char* name, uint){
+                    file_paths.push_back(dir.join(name));
                 }
-                file_obj.close();
-            }
-            return success;
-        }
-        else if (pattern.length() > 1){
-            uint caught_grp_count = 0;
-            vector<RegexPatternPortion> portions = extract_patterns(pattern, caught_grp_count);
-            BackRefManager backref_texts(caught_grp_count);
-            for (const auto& path: files){
-                ifstream file_obj(path);
-                while (getline(file_obj, input_line)) {
-                    cerr << "Current line (" << path << "): " << input_line << "\n";
-                    for (size_t start = 0; start <= input_line.size(); ++start) {
-                        if (match_here(input_line, portions, start, 0, backref_texts)) {
-                            success = true;
-                            cout << path << ":" << input_line << "\n";
-                            backref_texts.reset();
-                            break;
-                        }
-                        backref_texts.reset();
-                    }
-                }
-
-                file_obj.close();
-                backref_texts.reset();
-            }
-            return success;
-        }
-        else {
-            throw runtime_error("Unhandled pattern " + pattern);
+            );
+            return priv::search_files_parallel(file_paths, compiled, options);
         }
-    }
 
-    bool match_in_directory_recursive(const string& directory, const string& pattern){
-        vector<string> file_paths;
-        for (const auto& dir_entry: fs::recursive_directory_iterator(directory)){
-            file_paths.emplace_back(dir_entry.path().string());
-        }
-        return match_in_files(file_paths, pattern);
+        LineMatcher matcher(compiled, options);
+        FileReader reader(options.mmap_threshold);
+        OutputSink output = make_stdout_sink();
+        atomic<bool> success{false};
+        walk_directory(
+            directory,
+            [&matcher, &reader, &options, &output, &success](const WalkedDir& dir, const char* name, uint){
+                string_view buffer;
+                if (!reader.open_at(dir.get_fd(), name, buffer)){
+                    return;
+                }
+                if (priv::search_buffer(dir.join(name), buffer, matcher, options, true, output)){
+                    success.store(true, memory_order_relaxed);
+                }
+                output.release_borrowed();
+            },
+            options.output_mode == EOutputMode::QUIET ? &success : nullptr
+        );
+        priv::log_matcher_stats(matcher.get_dfa_flush_count());
+        return success;
     }
 }
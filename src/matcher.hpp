@@ -5,21 +5,34 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
-#include "backref_mgr.hpp"
 #include "chr_class_handlers.hpp"
 #include "chr_classes.hpp"
+#include "dir_walker.hpp"
+#include "file_reader.hpp"
+#include "line_matcher.hpp"
+#include "output_sink.hpp"
+#include "search_options.hpp"
+#include "stream_reader.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
 
 namespace cpp_grep{
     namespace fs = std::filesystem;
 
+    using std::atomic;
     using std::cerr;
     using std::cin;
     using std::cout;
@@ -27,51 +40,105 @@ namespace cpp_grep{
     using std::find_if;
     using std::getline;
     using std::ifstream;
+    using std::lock_guard;
+    using std::make_unique;
+    using std::memchr;
+    using std::memory_order_relaxed;
+    using std::min;
+    using std::mutex;
     using std::out_of_range;
     using std::runtime_error;
     using std::string;
-    using std::unreachable;
+    using std::string_view;
+    using std::to_string;
+    using std::unique_ptr;
     using std::vector;
 
-    /**
-     * @brief Matches a single character to the given pattern.
-     * This function only acts on simple character classes.
-     * More complex variants are handled directly in match_here instead.
-     * @param input The input character to match.
-     * @param portions The pattern match checks are performed on.
-     * @param pattern_index The pattern portion index used.
-     * @return true if a match was found, false otherwise.
-     */
-    bool match_char(char input, const vector<RegexPatternPortion>& portions, uint& pattern_index);
+    namespace priv{
+        /**
+         * @brief Collect every line of a file's contents matched by a pattern.
+         *
+         * Unless options.whole_buffer is disabled, the contents are searched as a single buffer.
+         * The search stops after the first options.max_count matched lines, or the first one if that's
+         * all the output mode needs. Once done, the file's count or path is written if the output mode asks for it.
+         * @param path The path to the file, as written before matched lines.
+         * @param buffer The file's contents.
+         * @param matcher The compiled pattern.
+         * @param options The search options.
+         * @param show_path Whether to write the file's path before each matched line.
+         * @param output The sink matched lines are written to. Lines are borrowed from the buffer.
+         * @param cancelled If given, the search stops (early, but not right away) once it is set.
+         * @return true if any line of the file was matched, false otherwise.
+         */
+        bool search_buffer(const string& path, string_view buffer, LineMatcher& matcher, const SearchOptions& options, bool show_path, OutputSink& output, const atomic<bool>* cancelled = nullptr);
 
-    /**
-     * @brief Main matching function. This is where the bulk of the work is done.
-     * @param input_line The input line a match is to be checked on.
-     * @param portions The pattern used for the match check.
-     * @param input_index The start index for the match.
-     * @param pattern_index The index in the portion list to use.
-     * @param backref_texts A reference to a backreference text manager object (see BackRefManager in backref_mgr.cpp/hpp).
-     * @param next_outside_portion A pointer to the next pattern portion in the enclosing nesting level, or nullptr if there isn't one for whatever reason.
-     * @param processed A pointer to an uint32_t which holds how many characters were processed during the match check.
-     * @return
-     */
-    bool match_here(
-        const string& input_line,
-        const vector<RegexPatternPortion>& portions,
-        uint input_index,
-        uint pattern_index,
-        BackRefManager& backref_texts,
-        RegexPatternPortion* next_outside_portion = nullptr,
-        uint* processed = nullptr
-    );
+        /**
+         * @brief Collect every line of a file matched by a pattern.
+         *
+         * Unless options.whole_buffer is disabled, the file is searched as a single buffer.
+         * @param path The path to the file to search. Files which can't be read are skipped.
+         * @param matcher The compiled pattern.
+         * @param reader The reader used to load the file.
+         * @param options The search options.
+         * @param show_path Whether to write the file's path before each matched line.
+         * @param output The sink matched lines are written to. Lines are borrowed from the reader's buffer.
+         * @param cancelled If given, the file is skipped if it is already set, and its search stops once it is set.
+         * @return true if any line of the file was matched, false otherwise.
+         */
+        bool search_file(const string& path, LineMatcher& matcher, FileReader& reader, const SearchOptions& options, bool show_path, OutputSink& output, const atomic<bool>* cancelled = nullptr);
+
+        /**
+         * @brief Collect every line of a file's contents matched by a pattern, splitting large contents across threads.
+         *
+         * With several threads, contents holding at least two chunks (see SearchOptions::chunk_size) are split
+         * into chunks ending on newlines, which are searched concurrently. Their results are written in the
+         * contents' order. Smaller contents, and searches which stop early (see search_buffer), are searched
+         * like search_buffer does.
+         * This spawns its own threads, so it must not be called from a worker of another search.
+         * @param path The path to the file, as written before matched lines.
+         * @param buffer The file's contents.
+         * @param matcher The compiled pattern, used for small contents. Chunks are searched with their own matchers.
+         * @param options The search options.
+         * @param show_path Whether to write the file's path before each matched line.
+         * @param output The sink matched lines are written to. Lines may be borrowed from the buffer.
+         * @return true if any line of the contents was matched, false otherwise.
+         */
+        bool search_buffer_chunked(const string& path, string_view buffer, LineMatcher& matcher, const SearchOptions& options, bool show_path, OutputSink& output);
+
+        /**
+         * @brief Collect every line of a file matched by a pattern, splitting large files across threads.
+         * See search_buffer_chunked.
+         * @param path The path to the file to search. Files which can't be read are skipped.
+         * @param matcher The compiled pattern, used for small files. Chunks are searched with their own matchers.
+         * @param reader The reader used to load the file.
+         * @param options The search options.
+         * @param show_path Whether to write the file's path before each matched line.
+         * @param output The sink matched lines are written to. Lines may be borrowed from the reader's buffer.
+         * @return true if any line of the file was matched, false otherwise.
+         */
+        bool search_file_chunked(const string& path, LineMatcher& matcher, FileReader& reader, const SearchOptions& options, bool show_path, OutputSink& output);
+    }
 
     /**
      * @brief Match a pattern on a single line.
      * @param input_line The input line the pattern will be matched against.
-     * @param pattern The pattern in question.
+     * @param patterns The pattern in question, or the fixed strings to look for (see SearchOptions::fixed_strings).
+     * @param options The search options.
      * @return true if the pattern was matched anywhere in the line, false otherwise.
      */
-    bool match_pattern(const string& input_line, const string& pattern);
+    bool match_pattern(const string& input_line, const vector<string>& patterns, const SearchOptions& options = SearchOptions{});
+
+    /**
+     * @brief Match a pattern on the standard input, until its end.
+     *
+     * Matched lines are printed into stdout as they are found. A redirected regular file is loaded
+     * like any other file; pipes and terminals are streamed with a bounded amount of memory,
+     * a background thread reading the next block while the current one is searched.
+     * @param patterns The pattern to match against, or the fixed strings to look for (see SearchOptions::fixed_strings).
+     * @param options The search options.
+     * @return true if a match was found in any line, false otherwise.
+     */
+    bool match_stdin(const vector<string>& patterns, const SearchOptions& options = SearchOptions{});
 
     /**
      * @brief Match a pattern on a file.
@@ -79,29 +146,33 @@ namespace cpp_grep{
      * The file can be multiline.
      * All found occurrences will be printed into stdout.
      * @param file The path to the file to check.
-     * @param pattern The pattern to match against.
+     * @param patterns The pattern to match against, or the fixed strings to look for (see SearchOptions::fixed_strings).
+     * @param options The search options.
      * @return true if a match was found at any point in the file, false otherwise.
      */
-    bool match_in_file(const string& file, const string& pattern);
+    bool match_in_file(const string& file, const vector<string>& patterns, const SearchOptions& options = SearchOptions{});
 
     /**
      * @brief Match a pattern in multiple different files.
      *
      * Any found occurrence will be printed in stdout with the file name shown before the line in question.
      * @param files A sequence containing file paths. The pattern will be checked for in all provided files.
-     * @param pattern The pattern to match against.
+     * @param patterns The pattern to match against, or the fixed strings to look for (see SearchOptions::fixed_strings).
+     * @param options The search options.
      * @return true if a match was found at any point in any of the given files, false otherwise.
      */
-    bool match_in_files(const vector<string>& files, const string& pattern);
+    bool match_in_files(const vector<string>& files, const vector<string>& patterns, const SearchOptions& options = SearchOptions{});
 
     /**
      * @brief Match a pattern in all the files in a directory.
      *
-     * The search is performed recursively.
+     * The search is performed recursively. Symbolic links to directories aren't followed.
      * Any found occurrence will be printed in stdout with the file path shown before the line in question.
      * @param directory The directory the check will be performed in.
-     * @param pattern The pattern to match against.
+     * @param patterns The pattern to match against, or the fixed strings to look for (see SearchOptions::fixed_strings).
+     * @param options The search options.
      * @return true if a match was found at any point in any of the files present in the directory and its subdirectories, false otherwise.
+     * @throw runtime_error if the directory can't be opened.
      */
-    bool match_in_directory_recursive(const string& directory, const string& pattern);
+    bool match_in_directory_recursive(const string& directory, const vector<string>& patterns, const SearchOptions& options = SearchOptions{});
 }
@@ -0,0 +1,174 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <algorithm>
+#include <cerrno>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "output_sink.hpp"
+
+namespace cpp_grep{
+    using std::min;
+
+    namespace priv{
+        // The copy buffer is flushed once it holds this many bytes.
+        constexpr size_t SINK_BUFFER_CAPACITY = 64 * 1024;
+
+        // The most segments a single writev call gets (POSIX guarantees at least 16, Linux allows 1024).
+        constexpr size_t SINK_MAX_IOVECS = 1024;
+
+        // Data shorter than this is copied even when it could be borrowed, as an iovec would cost more than the copy.
+        constexpr size_t SINK_MIN_BORROW_SIZE = 256;
+
+        /**
+         * Write a list of buffers to a file descriptor, retrying on short writes.
+         * @param fd The file descriptor to write to.
+         * @param iovecs The buffers to write. They are modified.
+         * @param count The amount of buffers.
+         * @return true if everything was written, false on error.
+         */
+        bool write_all(int fd, iovec* iovecs, size_t count){
+            while (count > 0){
+                ssize_t written = writev(fd, iovecs, static_cast<int>(count));
+                if (written < 0){
+                    if (errno == EINTR){
+                        continue;
+                    }
+                    return false;
+                }
+                auto remaining = static_cast<size_t>(written);
+                while (count > 0 && remaining >= iovecs->iov_len){
+                    remaining -= iovecs->iov_len;
+                    iovecs++;
+                    count--;
+                }
+                if (count > 0){
+                    iovecs->iov_base = static_cast<char*>(iovecs->iov_base) + remaining;
+                    iovecs->iov_len -= remaining;
+                }
+            }
+            return true;
+        }
+    }
+
+    OutputSink::OutputSink(): OutputSink(-1, false){
+    }
+
+    OutputSink::OutputSink(int fd, bool line_buffered): fd(fd), line_buffered(line_buffered){
+        if (fd >= 0){
+            copied.reserve(priv::SINK_BUFFER_CAPACITY);
+        }
+    }
+
+    OutputSink::~OutputSink(){
+        flush();
+    }
+
+    void OutputSink::write(string_view data){
+        if (data.empty()){
+            return;
+        }
+        if (!segments.empty() && segments.back().borrowed == nullptr){
+            // Extend the last segment, since it ends where the new data starts.
+            segments.back().size += data.size();
+        }
+        else{
+            segments.push_back(Segment{nullptr, copied.size(), data.size()});
+        }
+        copied += data;
+    }
+
+    void OutputSink::write_borrowed(string_view data){
+        if (data.size() < priv::SINK_MIN_BORROW_SIZE){
+            write(data);
+            return;
+        }
+        segments.push_back(Segment{data.data(), 0, data.size()});
+        has_borrowed = true;
+    }
+
+    /**
+     * Flush the sink if its copy buffer or segment list is full.
+     */
+    void OutputSink::flush_if_full(){
+        if (copied.size() >= priv::SINK_BUFFER_CAPACITY || segments.size() >= priv::SINK_MAX_IOVECS){
+            flush();
+        }
+    }
+
+    void OutputSink::end_line(){
+        if (line_buffered){
+            flush();
+            return;
+        }
+        flush_if_full();
+    }
+
+    void OutputSink::release_borrowed(){
+        if (!has_borrowed){
+            return;
+        }
+        if (fd >= 0){
+            flush();
+            return;
+        }
+        string contents;
+        move_to(contents);
+        write(contents);
+    }
+
+    void OutputSink::flush(){
+        if (fd < 0 || segments.empty()){
+            return;
+        }
+        vector<iovec> iovecs;
+        iovecs.reserve(min(segments.size(), priv::SINK_MAX_IOVECS));
+        for (size_t start = 0; start < segments.size(); start += priv::SINK_MAX_IOVECS){
+            iovecs.clear();
+            size_t end = min(segments.size(), start + priv::SINK_MAX_IOVECS);
+            for (size_t i = start; i < end; ++i){
+                const Segment& segment = segments[i];
+                const char* data = segment.borrowed != nullptr ? segment.borrowed : copied.data() + segment.offset;
+                iovecs.push_back(iovec{const_cast<char*>(data), segment.size});
+            }
+            if (!priv::write_all(fd, iovecs.data(), iovecs.size())){
+                break;
+            }
+        }
+        segments.clear();
+        copied.clear();
+        has_borrowed = false;
+    }
+
+    void OutputSink::move_to(OutputSink& target){
+        for (const Segment& segment: segments){
+            const char* data = segment.borrowed != nullptr ? segment.borrowed : copied.data() + segment.offset;
+            target.write(string_view(data, segment.size));
+            target.flush_if_full();
+        }
+        segments.clear();
+        copied.clear();
+        has_borrowed = false;
+    }
+
+    void OutputSink::move_to(string& target){
+        for (const Segment& segment: segments){
+            const char* data = segment.borrowed != nullptr ? segment.borrowed : copied.data() + segment.offset;
+            target.append(data, segment.size);
+        }
+        segments.clear();
+        copied.clear();
+        has_borrowed = false;
+    }
+
+    bool OutputSink::empty() const{
+        return segments.empty();
+    }
+
+    OutputSink make_stdout_sink(){
+        return OutputSink(STDOUT_FILENO, isatty(STDOUT_FILENO) != 0);
+    }
+}
@@ -0,0 +1,111 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace cpp_grep{
+    using std::string;
+    using std::string_view;
+    using std::vector;
+
+    /**
+     * @brief Batches output and writes it with as few writev calls as possible.
+     *
+     * Written data is either copied into a reusable buffer, or borrowed: only a reference to it is kept
+     * until the next flush, so lines of a memory-mapped file can be written without being copied.
+     * Sinks without a file descriptor only hold their contents, until they are moved into another sink.
+     */
+    class OutputSink{
+        // A piece of pending output: either a range of the copy buffer, or borrowed memory.
+        struct Segment{
+            const char* borrowed;   // nullptr for data in the copy buffer.
+            size_t offset;          // Offset in the copy buffer, if not borrowed.
+            size_t size;
+        };
+
+        int fd;
+        bool line_buffered;
+        string copied;
+        vector<Segment> segments;
+        bool has_borrowed{false};
+
+        void flush_if_full();
+
+        public:
+            /**
+             * Create a sink holding its contents in memory.
+             */
+            OutputSink();
+
+            /**
+             * Create a sink writing to a file descriptor.
+             * @param fd The file descriptor to write to.
+             * @param line_buffered Whether to flush after every line.
+             */
+            OutputSink(int fd, bool line_buffered);
+
+            /**
+             * Flush any pending output.
+             */
+            ~OutputSink();
+
+            // Segments may point into the sink's own buffer.
+            OutputSink(const OutputSink&) = delete;
+            OutputSink& operator=(const OutputSink&) = delete;
+
+            /**
+             * Copy data into the sink.
+             * @param data The data to write.
+             */
+            void write(string_view data);
+
+            /**
+             * Reference data from the sink, without copying it.
+             * @param data The data to write. It must stay valid until the next call to flush, release_borrowed or move_to.
+             */
+            void write_borrowed(string_view data);
+
+            /**
+             * Signal the end of a line, flushing the sink if it is line-buffered or full.
+             */
+            void end_line();
+
+            /**
+             * Make sure no borrowed data is referenced anymore, flushing the sink if needed.
+             * In-memory sinks copy borrowed data instead.
+             */
+            void release_borrowed();
+
+            /**
+             * Write all pending output to the file descriptor. Does nothing for in-memory sinks.
+             * Write errors (e.g. a closed pipe) are ignored, and the output discarded.
+             */
+            void flush();
+
+            /**
+             * Append the sink's contents to another sink, then empty this one.
+             * @param target The sink to move the contents to. The contents are copied into it.
+             */
+            void move_to(OutputSink& target);
+
+            /**
+             * Append the sink's contents to a string, then empty the sink.
+             * @param target The string to append to.
+             */
+            void move_to(string& target);
+
+            [[nodiscard]] bool empty() const;
+    };
+
+    /**
+     * Create a sink writing to the standard output, line-buffered only if it is a terminal.
+     * @return The sink.
+     */
+    OutputSink make_stdout_sink();
+}
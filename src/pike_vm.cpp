@@ -0,0 +1,131 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include "pike_vm.hpp"
+
+namespace cpp_grep{
+    // region PikeVM
+    PikeVM::PikeVM(const Program& program)
+    : program(&program),
+      current(static_cast<uint>(program.insts.size())),
+      next(static_cast<uint>(program.insts.size())),
+      follow_stack(2 * program.insts.size() + 1){}
+
+    /**
+     * Add a thread to a list, following every non-consuming instruction reachable from it.
+     * @param list The thread list to add to.
+     * @param pc The instruction the thread starts at.
+     * @param pos The current position in the input line.
+     * @param size The size of the input line.
+     * @param patterns If not null, the patterns of the MATCH instructions reached are appended to it,
+     * and following goes on past them.
+     * @return true if a MATCH instruction was reached (and patterns is null), false otherwise.
+     */
+    bool PikeVM::add_thread(SparseSet& list, uint pc, size_t pos, size_t size, vector<uint>* patterns){
+        // Every instruction is inserted at most once and pushes at most two successors,
+        // so the preallocated stack can never overflow.
+        uint top = 0;
+        follow_stack[top++] = pc;
+        while (top > 0){
+            uint cur = follow_stack[--top];
+            if (list.contains(cur)){
+                continue;
+            }
+            list.insert(cur);
+
+            const Inst& inst = program->insts[cur];
+            switch (inst.op){
+                case EOpcode::MATCH:
+                    if (patterns == nullptr){
+                        return true;
+                    }
+                    patterns->push_back(inst.x);
+                    break;
+                case EOpcode::JUMP:
+                    follow_stack[top++] = cur + inst.x;
+                    break;
+                case EOpcode::SPLIT:
+                    follow_stack[top++] = cur + inst.y;
+                    follow_stack[top++] = cur + inst.x;
+                    break;
+                case EOpcode::SAVE:
+                    // Captures are only needed by backreferences, which this engine doesn't support.
+                    follow_stack[top++] = cur + 1;
+                    break;
+                case EOpcode::START_ANCHOR:
+                    if (pos == 0){
+                        follow_stack[top++] = cur + 1;
+                    }
+                    break;
+                case EOpcode::END_ANCHOR:
+                    if (pos == size){
+                        follow_stack[top++] = cur + 1;
+                    }
+                    break;
+                default:
+                    // Consuming instruction: stays in the list until the next character is read.
+                    break;
+            }
+        }
+        return false;
+    }
+
+    bool PikeVM::search(string_view input_line){
+        size_t size = input_line.size();
+        current.clear();
+        for (size_t pos = 0; pos <= size; ++pos){
+            if (current.empty()){
+                // No match in progress: jump to the next position a match can start at.
+                pos = program->next_start(input_line, pos);
+                if (pos > size){
+                    return false;
+                }
+            }
+            // Unanchored search: a new thread starts at every position.
+            if (add_thread(current, 0, pos, size)){
+                return true;
+            }
+            if (pos == size){
+                break;
+            }
+
+            char chr = input_line[pos];
+            next.clear();
+            for (uint pc: current){
+                if (program->accepts(program->insts[pc], chr) && add_thread(next, pc + 1, pos + 1, size)){
+                    return true;
+                }
+            }
+            swap(current, next);
+        }
+        return false;
+    }
+
+    void PikeVM::collect_matches(string_view input_line, vector<uint>& patterns){
+        size_t size = input_line.size();
+        current.clear();
+        for (size_t pos = 0; pos <= size; ++pos){
+            if (current.empty()){
+                pos = program->next_start(input_line, pos);
+                if (pos > size){
+                    break;
+                }
+            }
+            static_cast<void>(add_thread(current, 0, pos, size, &patterns));
+            if (pos == size){
+                break;
+            }
+
+            char chr = input_line[pos];
+            next.clear();
+            for (uint pc: current){
+                if (program->accepts(program->insts[pc], chr)){
+                    static_cast<void>(add_thread(next, pc + 1, pos + 1, size, &patterns));
+                }
+            }
+            swap(current, next);
+        }
+    }
+    // endregion
+}
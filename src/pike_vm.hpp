@@ -0,0 +1,62 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "program.hpp"
+#include "sparse_set.hpp"
+
+namespace cpp_grep{
+    using ubyte = uint8_t;
+    using uint = uint32_t;
+
+    using std::string;
+    using std::string_view;
+    using std::swap;
+    using std::vector;
+
+    /**
+     * @brief A Pike VM running a compiled program over input lines.
+     *
+     * All possible threads are advanced in lockstep over the input, so a search runs in
+     * O(instruction count × line length) no matter how the pattern is written.
+     * Thread lists are allocated once on construction and reused for every search.
+     */
+    class PikeVM{
+        const Program* program;
+        SparseSet current;
+        SparseSet next;
+        vector<uint> follow_stack;
+
+        [[nodiscard]] bool add_thread(SparseSet& list, uint pc, size_t pos, size_t size, vector<uint>* patterns = nullptr);
+
+        public:
+            /**
+             * Prepare a Pike VM for the given program.
+             * @param program The program to run. It must outlive the VM and must not contain backreferences.
+             */
+            explicit PikeVM(const Program& program);
+
+            /**
+             * @brief Check if the program matches anywhere in the given line.
+             * @param input_line The line to search.
+             * @return true if a match was found, false otherwise.
+             */
+            [[nodiscard]] bool search(string_view input_line);
+
+            /**
+             * @brief Find every pattern of a program compiled from several ones which matches in a line.
+             * @param input_line The line to search.
+             * @param patterns The indices of the matched patterns are appended to it, possibly more than once.
+             */
+            void collect_matches(string_view input_line, vector<uint>& patterns);
+    };
+}
@@ -0,0 +1,78 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include "prefilter.hpp"
+
+namespace cpp_grep{
+    namespace priv{
+        /**
+         * @brief Literal runs found so far while walking a pattern.
+         */
+        struct LiteralRuns{
+            string current;     // Literals matched back to back up to the current portion.
+            string longest;     // The longest run which was closed so far.
+        };
+
+        /**
+         * End the current run of literals, keeping it if it is the longest one so far.
+         * @param runs The runs being collected.
+         */
+        void close_run(LiteralRuns& runs){
+            if (runs.current.size() > runs.longest.size()){
+                runs.longest = runs.current;
+            }
+            runs.current.clear();
+        }
+
+        /**
+         * Collect the runs of required literals of a portion sequence.
+         * @param portions The portions to walk.
+         * @param runs The runs being collected.
+         */
+        void collect_required_literals(const vector<RegexPatternPortion>& portions, LiteralRuns& runs){  // NOLINT
+            using enum ECharClass;
+            for (const auto& portion: portions){
+                switch (portion.get_char_cls()){
+                    case LITERAL:
+                        runs.current.push_back(portion.get_literal());
+                        break;
+                    case ONE_OR_MORE:
+                        // The first occurrence ends the current run, the last one starts the next.
+                        runs.current.push_back(portion.get_literal());
+                        close_run(runs);
+                        runs.current.push_back(portion.get_literal());
+                        break;
+                    case START_ANCHOR:
+                    case END_ANCHOR:
+                        // Anchors don't consume anything, so literals on both sides stay adjacent.
+                        break;
+                    case PATTERN:
+                        // A group matched exactly once is just a part of the sequence.
+                        collect_required_literals(portion.get_subpattern(), runs);
+                        break;
+                    case PATTERN_LEAST_ONE:
+                    {
+                        close_run(runs);
+                        LiteralRuns inner;
+                        collect_required_literals(portion.get_subpattern(), inner);
+                        close_run(inner);
+                        runs.current = inner.longest;
+                        close_run(runs);
+                        break;
+                    }
+                    default:
+                        close_run(runs);
+                        break;
+                }
+            }
+        }
+    }
+
+    string find_required_literal(const vector<RegexPatternPortion>& portions){
+        priv::LiteralRuns runs;
+        priv::collect_required_literals(portions, runs);
+        priv::close_run(runs);
+        return runs.longest;
+    }
+}
@@ -0,0 +1,25 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "chr_classes.hpp"
+
+namespace cpp_grep{
+    using std::string;
+    using std::vector;
+
+    /**
+     * @brief Find the longest literal string every match of a pattern must contain.
+     *
+     * Only literals which are always matched back to back are combined, so the result is a
+     * substring of any text the pattern matches. Optional or alternative parts end a run.
+     * @param portions The pattern to analyse.
+     * @return The longest required literal, or an empty string if the pattern doesn't require any.
+     */
+    string find_required_literal(const vector<RegexPatternPortion>& portions);
+}
@@ -0,0 +1,515 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include "program.hpp"
+
+namespace cpp_grep{
+    namespace priv{
+        // How many times the instruction(s) compiled from a portion must be matched.
+        enum class ERepeat: ubyte{
+            ONCE,
+            ONE_OR_MORE,
+            ZERO_OR_ONE,
+        };
+
+        void compile_portions(const vector<RegexPatternPortion>& portions, Program& program, bool reversed);  // NOLINT
+
+        /**
+         * Append an instruction to a program.
+         * @param program The program to append to.
+         * @param op The instruction's opcode.
+         * @param arg The instruction's argument.
+         * @return The index of the new instruction.
+         */
+        uint emit(Program& program, EOpcode op, uint16_t arg = 0){
+            auto index = static_cast<uint>(program.insts.size());
+            program.insts.push_back(Inst{op, arg});
+            return index;
+        }
+
+        /**
+         * Get the offset between two instructions.
+         * @param from The instruction the offset is stored in.
+         * @param to The instruction to continue at.
+         * @return The relative offset to store.
+         */
+        int32_t offset_to(uint from, uint to){
+            return static_cast<int32_t>(to) - static_cast<int32_t>(from);
+        }
+
+        /**
+         * Wrap the instructions emitted by emit_body according to the given repetition.
+         * @param program The program to append to.
+         * @param repeat The repetition to apply.
+         * @param emit_body A callable appending the repeated instructions to the program.
+         */
+        template<typename BodyFunc> void emit_repeat(Program& program, ERepeat repeat, BodyFunc emit_body){
+            switch (repeat){
+                case ERepeat::ONCE:
+                    emit_body();
+                    break;
+                case ERepeat::ONE_OR_MORE:
+                {
+                    auto body_start = static_cast<uint>(program.insts.size());
+                    emit_body();
+                    uint split = emit(program, EOpcode::SPLIT);
+                    program.insts[split].x = offset_to(split, body_start);
+                    program.insts[split].y = 1;
+                    break;
+                }
+                case ERepeat::ZERO_OR_ONE:
+                {
+                    uint split = emit(program, EOpcode::SPLIT);
+                    emit_body();
+                    program.insts[split].x = 1;
+                    program.insts[split].y = offset_to(split, static_cast<uint>(program.insts.size()));
+                    break;
+                }
+            }
+        }
+
+        /**
+         * Compile a single pattern portion into the given program.
+         * @param portion The portion to compile.
+         * @param program The program to append to.
+         * @param reversed Whether to compile the portion so that it matches its text read backwards.
+         * @throw logic_error if the portion is reversed and contains a backreference.
+         * @throw runtime_error if the program ends up with more than MAX_GROUP_COUNT capture groups.
+         */
+        void compile_portion(const RegexPatternPortion& portion, Program& program, bool reversed){  // NOLINT
+            using enum ECharClass;
+
+            ERepeat repeat = ERepeat::ONCE;
+            switch (portion.get_char_cls()){
+                case DIGIT_LEAST_ONE:
+                case WORD_LEAST_ONE:
+                case CHAR_GROUP_LEAST_ONE:
+                case ONE_OR_MORE:
+                case ANY_LEAST_ONE:
+                case PATTERN_LEAST_ONE:
+                case BACKREF_LEAST_ONE:
+                    repeat = ERepeat::ONE_OR_MORE;
+                    break;
+                case DIGIT_MOST_ONE:
+                case WORD_MOST_ONE:
+                case CHAR_GROUP_MOST_ONE:
+                case ZERO_OR_ONE:
+                case ANY_MOST_ONE:
+                case PATTERN_MOST_ONE:
+                case BACKREF_MOST_ONE:
+                    repeat = ERepeat::ZERO_OR_ONE;
+                    break;
+                default:
+                    break;
+            }
+
+            switch (portion.get_char_cls()){
+                case ANY:
+                case ANY_LEAST_ONE:
+                case ANY_MOST_ONE:
+                    emit_repeat(program, repeat, [&program](){ emit(program, EOpcode::ANY); });
+                    break;
+                case LITERAL:
+                case ONE_OR_MORE:
+                case ZERO_OR_ONE:
+                {
+                    auto literal = static_cast<ubyte>(portion.get_literal());
+                    emit_repeat(program, repeat, [&program, literal](){ emit(program, EOpcode::LITERAL, literal); });
+                    break;
+                }
+                case DIGIT:
+                case DIGIT_LEAST_ONE:
+                case DIGIT_MOST_ONE:
+                    emit_repeat(program, repeat, [&program](){ emit(program, EOpcode::DIGIT); });
+                    break;
+                case WORD:
+                case WORD_LEAST_ONE:
+                case WORD_MOST_ONE:
+                    emit_repeat(program, repeat, [&program](){ emit(program, EOpcode::WORD); });
+                    break;
+                case CHAR_GROUP:
+                case CHAR_GROUP_LEAST_ONE:
+                case CHAR_GROUP_MOST_ONE:
+                {
+                    auto grp_index = static_cast<int32_t>(program.char_grps.size());
+                    program.char_grps.push_back(portion.get_char_set());
+                    emit_repeat(
+                        program,
+                        repeat,
+                        [&program, grp_index](){
+                            uint index = emit(program, EOpcode::CHAR_GROUP);
+                            program.insts[index].x = grp_index;
+                        }
+                    );
+                    break;
+                }
+                case START_ANCHOR:
+                    // Read backwards, the start of the line is where the text ends.
+                    emit(program, reversed ? EOpcode::END_ANCHOR : EOpcode::START_ANCHOR);
+                    break;
+                case END_ANCHOR:
+                    emit(program, reversed ? EOpcode::START_ANCHOR : EOpcode::END_ANCHOR);
+                    break;
+                case OR:
+                {
+                    uint split = emit(program, EOpcode::SPLIT);
+                    compile_portions(portion.get_subpattern1(), program, reversed);
+                    uint jump = emit(program, EOpcode::JUMP);
+                    program.insts[split].x = 1;
+                    program.insts[split].y = offset_to(split, jump + 1);
+                    compile_portions(portion.get_subpattern2(), program, reversed);
+                    program.insts[jump].x = offset_to(jump, static_cast<uint>(program.insts.size()));
+                    break;
+                }
+                case PATTERN:
+                case PATTERN_LEAST_ONE:
+                case PATTERN_MOST_ONE:
+                {
+                    // Groups are numbered before their subgroups, as extract_patterns does.
+                    if (program.group_count >= MAX_GROUP_COUNT){
+                        throw runtime_error("Too many capture groups (at most " + to_string(MAX_GROUP_COUNT) + " are supported)");
+                    }
+                    auto group = static_cast<uint16_t>(program.group_count++);
+                    const auto& subpattern = portion.get_subpattern();
+                    emit_repeat(
+                        program,
+                        repeat,
+                        [&program, &subpattern, group, reversed](){
+                            emit(program, EOpcode::SAVE, static_cast<uint16_t>(2 * group));
+                            compile_portions(subpattern, program, reversed);
+                            emit(program, EOpcode::SAVE, static_cast<uint16_t>(2 * group + 1));
+                        }
+                    );
+                    break;
+                }
+                case BACKREFERENCE:
+                case BACKREF_LEAST_ONE:
+                case BACKREF_MOST_ONE:
+                {
+                    if (reversed){
+                        throw logic_error("Cannot reverse a pattern containing backreferences");
+                    }
+                    ubyte group = portion.get_backref_index();
+                    program.has_backrefs = true;
+                    emit_repeat(program, repeat, [&program, group](){ emit(program, EOpcode::BACKREF, group); });
+                    break;
+                }
+            }
+        }
+
+        // Relaxed programs larger than this replace further backreferences with "any string".
+        constexpr size_t MAX_RELAXED_SIZE = 4096;
+
+        /**
+         * Append instructions matching any string (possibly empty) to a program.
+         * @param program The program to append to.
+         */
+        void emit_any_string(Program& program){
+            uint split = emit(program, EOpcode::SPLIT);
+            emit(program, EOpcode::ANY);
+            uint jump = emit(program, EOpcode::JUMP);
+            program.insts[split].x = 1;
+            program.insts[split].y = offset_to(split, jump + 1);
+            program.insts[jump].x = offset_to(jump, split);
+        }
+
+        void emit_relaxed_range(const Program& source, uint from, uint to, bool in_group, vector<bool>& expanding, Program& relaxed);  // NOLINT
+
+        /**
+         * Append instructions matching whatever a capture group can match, in place of a backreference to it.
+         * @param source The program containing the group.
+         * @param group The group's index.
+         * @param expanding Which groups are already being expanded, to cut cycles.
+         * @param relaxed The program to append to.
+         */
+        void emit_group_body(const Program& source, uint16_t group, vector<bool>& expanding, Program& relaxed){  // NOLINT
+            uint start = 0;
+            uint end = 0;
+            for (uint pc = 0; pc < source.insts.size(); ++pc){
+                const Inst& inst = source.insts[pc];
+                if (inst.op != EOpcode::SAVE){
+                    continue;
+                }
+                if (inst.arg == 2 * group){
+                    start = pc + 1;
+                }
+                else if (inst.arg == 2 * group + 1){
+                    end = pc;
+                }
+            }
+
+            if (expanding[group] || end < start || relaxed.insts.size() + (end - start) > MAX_RELAXED_SIZE){
+                // A group referring to itself, or too much to copy: anything is still a superset.
+                emit_any_string(relaxed);
+                return;
+            }
+            expanding[group] = true;
+            emit_relaxed_range(source, start, end, true, expanding, relaxed);
+            expanding[group] = false;
+        }
+
+        /**
+         * Copy a range of instructions into a relaxed program, expanding the backreferences it contains.
+         * Jumps are relocated, as expansions change the distance between instructions.
+         * @param source The program to copy from.
+         * @param from The first instruction to copy.
+         * @param to The instruction after the last one to copy. Jumps may target it.
+         * @param in_group Whether the range is a group's body copied in place of a backreference.
+         * Anchors are dropped from such copies, since the referenced text can appear anywhere.
+         * @param expanding Which groups are already being expanded, to cut cycles.
+         * @param relaxed The program to append to.
+         */
+        void emit_relaxed_range(const Program& source, uint from, uint to, bool in_group, vector<bool>& expanding, Program& relaxed){  // NOLINT
+            vector<uint> new_pcs(to - from + 1);
+            for (uint pc = from; pc < to; ++pc){
+                new_pcs[pc - from] = static_cast<uint>(relaxed.insts.size());
+                Inst inst = source.insts[pc];
+                switch (inst.op){
+                    case EOpcode::BACKREF:
+                        emit_group_body(source, inst.arg, expanding, relaxed);
+                        continue;
+                    case EOpcode::START_ANCHOR:
+                    case EOpcode::END_ANCHOR:
+                        if (in_group){
+                            inst = Inst{EOpcode::JUMP, 0, 1};
+                        }
+                        break;
+                    case EOpcode::JUMP:
+                    case EOpcode::SPLIT:
+                        // Store absolute targets for now, they are relocated once the whole range is copied.
+                        inst.x += static_cast<int32_t>(pc);
+                        inst.y += static_cast<int32_t>(pc);
+                        break;
+                    default:
+                        break;
+                }
+                relaxed.insts.push_back(inst);
+            }
+            new_pcs[to - from] = static_cast<uint>(relaxed.insts.size());
+
+            for (uint pc = from; pc < to; ++pc){
+                EOpcode op = source.insts[pc].op;
+                if (op != EOpcode::JUMP && op != EOpcode::SPLIT){
+                    continue;
+                }
+                uint new_pc = new_pcs[pc - from];
+                Inst& inst = relaxed.insts[new_pc];
+                inst.x = offset_to(new_pc, new_pcs[inst.x - from]);
+                if (op == EOpcode::SPLIT){
+                    inst.y = offset_to(new_pc, new_pcs[inst.y - from]);
+                }
+            }
+        }
+
+        /**
+         * Check if every match of a program has to start at the start of the line.
+         * @param program The program, whose anchored_start is set.
+         */
+        void find_start_anchor(Program& program){
+            vector<bool> visited(program.insts.size(), false);
+            vector<uint> stack{0};
+            while (!stack.empty()){
+                uint cur = stack.back();
+                stack.pop_back();
+                if (visited[cur]){
+                    continue;
+                }
+                visited[cur] = true;
+
+                const Inst& inst = program.insts[cur];
+                switch (inst.op){
+                    case EOpcode::JUMP:
+                        stack.push_back(cur + inst.x);
+                        break;
+                    case EOpcode::SPLIT:
+                        stack.push_back(cur + inst.x);
+                        stack.push_back(cur + inst.y);
+                        break;
+                    case EOpcode::SAVE:
+                        stack.push_back(cur + 1);
+                        break;
+                    case EOpcode::START_ANCHOR:
+                        // This path is anchored: don't look past it.
+                        break;
+                    default:
+                        // Something can be matched without going through an anchor.
+                        return;
+                }
+            }
+            program.anchored_start = true;
+        }
+
+        /**
+         * Compute the bytes a program's matches can start with.
+         * Nothing is recorded if a match can be found without consuming anything first
+         * (empty matches, end anchors, backreferences), or if any byte can start a match.
+         * @param program The program, whose first_bytes and has_first_bytes are set.
+         */
+        void find_first_bytes(Program& program){
+            ByteSet first_bytes;
+            vector<bool> visited(program.insts.size(), false);
+            vector<uint> stack{0};
+            while (!stack.empty()){
+                uint cur = stack.back();
+                stack.pop_back();
+                if (visited[cur]){
+                    continue;
+                }
+                visited[cur] = true;
+
+                const Inst& inst = program.insts[cur];
+                switch (inst.op){
+                    case EOpcode::JUMP:
+                        stack.push_back(cur + inst.x);
+                        break;
+                    case EOpcode::SPLIT:
+                        stack.push_back(cur + inst.x);
+                        stack.push_back(cur + inst.y);
+                        break;
+                    case EOpcode::SAVE:
+                    case EOpcode::START_ANCHOR:
+                        stack.push_back(cur + 1);
+                        break;
+                    case EOpcode::END_ANCHOR:
+                    case EOpcode::BACKREF:
+                    case EOpcode::MATCH:
+                        return;
+                    default:
+                        for (uint chr = 0; chr < 256; ++chr){
+                            if (program.accepts(inst, static_cast<char>(chr))){
+                                first_bytes.insert(static_cast<ubyte>(chr));
+                            }
+                        }
+                        break;
+                }
+            }
+            if (first_bytes.count() == 256){
+                return;
+            }
+            program.first_bytes = ClassScanner(first_bytes);
+            program.has_first_bytes = true;
+        }
+
+        /**
+         * Compile a sequence of pattern portions into the given program.
+         * @param portions The portions to compile.
+         * @param program The program to append to.
+         * @param reversed Whether to compile the portions so that they match their text read backwards,
+         * i.e. last portion first.
+         */
+        void compile_portions(const vector<RegexPatternPortion>& portions, Program& program, bool reversed){  // NOLINT
+            for (size_t i = 0; i < portions.size(); ++i){
+                compile_portion(portions[reversed ? portions.size() - 1 - i : i], program, reversed);
+            }
+        }
+    }
+
+    bool Program::accepts(const Inst& inst, char chr) const{
+        switch (inst.op){
+            case EOpcode::LITERAL:
+                return static_cast<ubyte>(chr) == inst.arg;
+            case EOpcode::ANY:
+                return true;
+            case EOpcode::DIGIT:
+                return priv::is_digit(chr);
+            case EOpcode::WORD:
+                return priv::is_word(chr);
+            case EOpcode::CHAR_GROUP:
+                return char_grps[inst.x].contains(chr);
+            default:
+                return false;
+        }
+    }
+
+    size_t Program::next_start(string_view input_line, size_t from) const{
+        if (anchored_start && from > 0){
+            return input_line.size() + 1;
+        }
+        if (!has_first_bytes || from >= input_line.size()){
+            return from;
+        }
+        return from + first_bytes.find_first(input_line.data() + from, input_line.size() - from);
+    }
+
+    bool has_backreferences(const vector<RegexPatternPortion>& portions){  // NOLINT
+        using enum ECharClass;
+        for (const auto& portion: portions){
+            switch (portion.get_char_cls()){
+                case BACKREFERENCE:
+                case BACKREF_LEAST_ONE:
+                case BACKREF_MOST_ONE:
+                    return true;
+                case OR:
+                    if (has_backreferences(portion.get_subpattern1()) || has_backreferences(portion.get_subpattern2())){
+                        return true;
+                    }
+                    break;
+                case PATTERN:
+                case PATTERN_LEAST_ONE:
+                case PATTERN_MOST_ONE:
+                    if (has_backreferences(portion.get_subpattern())){
+                        return true;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        return false;
+    }
+
+    Program compile_program(const vector<RegexPatternPortion>& portions){
+        Program program;
+        priv::compile_portions(portions, program, false);
+        priv::emit(program, EOpcode::MATCH);
+        priv::find_start_anchor(program);
+        priv::find_first_bytes(program);
+        return program;
+    }
+
+    Program compile_program_reversed(const vector<RegexPatternPortion>& portions){
+        Program program;
+        priv::compile_portions(portions, program, true);
+        priv::emit(program, EOpcode::MATCH);
+        priv::find_start_anchor(program);
+        priv::find_first_bytes(program);
+        return program;
+    }
+
+    Program compile_program_set(const vector<vector<RegexPatternPortion>>& patterns){
+        Program program;
+        for (uint index = 0; index < patterns.size(); ++index){
+            if (has_backreferences(patterns[index])){
+                throw runtime_error("Backreferences can't be used when several patterns are given");
+            }
+            uint split = 0;
+            bool has_next = index + 1 < patterns.size();
+            if (has_next){
+                split = priv::emit(program, EOpcode::SPLIT);
+                program.insts[split].x = 1;
+            }
+            priv::compile_portions(patterns[index], program, false);
+            uint match = priv::emit(program, EOpcode::MATCH);
+            program.insts[match].x = static_cast<int32_t>(index);
+            if (has_next){
+                program.insts[split].y = priv::offset_to(split, match + 1);
+            }
+        }
+        program.pattern_count = static_cast<uint>(patterns.size());
+        priv::find_start_anchor(program);
+        priv::find_first_bytes(program);
+        return program;
+    }
+
+    Program relax_backreferences(const Program& program){
+        Program relaxed;
+        relaxed.char_grps = program.char_grps;
+        relaxed.group_count = program.group_count;
+        vector<bool> expanding(program.group_count, false);
+        priv::emit_relaxed_range(program, 0, static_cast<uint>(program.insts.size()), false, expanding, relaxed);
+        priv::find_start_anchor(relaxed);
+        priv::find_first_bytes(relaxed);
+        return relaxed;
+    }
+}
@@ -0,0 +1,140 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "byte_set.hpp"
+#include "chr_class_handlers.hpp"
+#include "chr_classes.hpp"
+#include "class_scan.hpp"
+
+namespace cpp_grep{
+    using ubyte = uint8_t;
+    using uint = uint32_t;
+
+    using std::logic_error;
+    using std::runtime_error;
+    using std::string;
+    using std::string_view;
+    using std::to_string;
+    using std::vector;
+
+    // An enum representing all bytecode instructions.
+    // Unless stated otherwise, an instruction continues at the one right after it.
+    enum class EOpcode: ubyte{
+        LITERAL,        // Consume one character equal to arg.
+        ANY,            // Consume any character.
+        DIGIT,          // Consume one digit character.
+        WORD,           // Consume one word character.
+        CHAR_GROUP,     // Consume one character in the byte set at index x.
+        SPLIT,          // Continue at both pc + x (preferred) and pc + y without consuming anything.
+        JUMP,           // Continue at pc + x without consuming anything.
+        START_ANCHOR,   // Only continue if the current position is the start of the line.
+        END_ANCHOR,     // Only continue if the current position is the end of the line.
+        SAVE,           // Record the current position in capture slot arg (2n: start of group n, 2n + 1: its end).
+        BACKREF,        // Consume the text last captured by group arg.
+        MATCH,          // Pattern x was matched (always 0, unless several patterns were compiled together).
+    };
+
+    constexpr uint MAX_GROUP_COUNT = UINT16_MAX / 2;  // Capture groups a program can hold (see SAVE).
+
+    /**
+     * @brief A single bytecode instruction.
+     * See EOpcode for the meaning of each field.
+     */
+    struct Inst{
+        EOpcode op;
+        uint16_t arg{0};    // Wide enough for the capture slots of MAX_GROUP_COUNT groups.
+        int32_t x{0};
+        int32_t y{0};
+    };
+
+    /**
+     * @brief A pattern lowered into a flat instruction array.
+     *
+     * Every engine runs on this representation instead of the RegexPatternPortion tree:
+     * jumps are relative offsets inside one contiguous array, and character groups live
+     * in a side table, so walking a program never allocates.
+     */
+    struct Program{
+        vector<Inst> insts;         // Instruction 0 is the entry point.
+        vector<ByteSet> char_grps;  // Character groups referenced by CHAR_GROUP instructions.
+        uint group_count{0};        // Number of capture groups (each one uses two SAVE slots).
+        bool has_backrefs{false};   // Whether the program contains BACKREF instructions.
+        uint pattern_count{1};      // Number of patterns compiled together, each one ending with its own MATCH.
+        ClassScanner first_bytes;   // Bytes a match can start with, only meaningful if has_first_bytes is set.
+        bool has_first_bytes{false};    // Whether every match starts by consuming one of first_bytes.
+        bool anchored_start{false};     // Whether every match starts at the start of the line.
+
+        /**
+         * @brief Check if a consuming instruction accepts the given character.
+         * @param inst The instruction to check. It must belong to this program.
+         * @param chr The input character.
+         * @return true if the character is accepted, false otherwise (including for non-consuming instructions).
+         */
+        [[nodiscard]] bool accepts(const Inst& inst, char chr) const;
+
+        /**
+         * @brief Find the next position of a line at which a match can start.
+         * Positions whose byte can't start a match are skipped with a class scan over first_bytes.
+         * @param input_line The line being searched.
+         * @param from The first position to consider.
+         * @return The first candidate position from the given one, or the line's size if there isn't any.
+         * Positions at or past the end of the line are returned as they are, except for start-anchored programs,
+         * for which any position past the start yields the line's size plus one: no match can start there.
+         */
+        [[nodiscard]] size_t next_start(string_view input_line, size_t from) const;
+    };
+
+    /**
+     * @brief Check whether a pattern (or any of its subpatterns) contains a backreference.
+     * @param portions The pattern to check.
+     * @return true if any portion is a BACKREFERENCE, BACKREF_LEAST_ONE or BACKREF_MOST_ONE portion, false otherwise.
+     */
+    bool has_backreferences(const vector<RegexPatternPortion>& portions);
+
+    /**
+     * @brief Lower a pattern into bytecode.
+     * Capture groups are numbered in the same order as extract_patterns numbers them.
+     * @param portions The pattern to compile.
+     * @return The compiled program, terminated by a MATCH instruction.
+     * @throw runtime_error if the pattern has more than MAX_GROUP_COUNT capture groups.
+     */
+    Program compile_program(const vector<RegexPatternPortion>& portions);
+
+    /**
+     * @brief Lower a pattern into bytecode matching its text read backwards, from the end of the line.
+     * Portions are compiled last first, and start and end anchors trade places.
+     * Running the result over a line read from its end finds the same lines as the forward program.
+     * @param portions The pattern to compile. It must not contain backreferences.
+     * @return The reversed program, terminated by a MATCH instruction.
+     * @throw logic_error if the pattern contains backreferences.
+     * @throw runtime_error if the pattern has more than MAX_GROUP_COUNT capture groups.
+     */
+    Program compile_program_reversed(const vector<RegexPatternPortion>& portions);
+
+    /**
+     * @brief Lower several patterns into a single program, matching wherever any of them matches.
+     * Each pattern ends with a MATCH instruction carrying its index, so engines can tell which ones matched.
+     * @param patterns The patterns to compile. There must be at least one.
+     * @return The compiled program.
+     * @throw runtime_error if one of the patterns contains backreferences, or if they have more than MAX_GROUP_COUNT capture groups.
+     */
+    Program compile_program_set(const vector<vector<RegexPatternPortion>>& patterns);
+
+    /**
+     * @brief Build a program matching a superset of what a program with backreferences matches.
+     * Each backreference is replaced with a copy of the referenced group's body, i.e. whatever the group can match.
+     * The result contains no BACKREF instructions, so the automata can run it to reject lines cheaply.
+     * @param program The program to relax.
+     * @return The relaxed program.
+     */
+    Program relax_backreferences(const Program& program);
+}
@@ -0,0 +1,44 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace cpp_grep{
+    namespace priv{
+        constexpr size_t DEFAULT_DFA_CACHE_SIZE = 2 * 1024 * 1024;  // 2 MiB
+        constexpr size_t DEFAULT_MMAP_THRESHOLD = 256 * 1024;        // 256 KiB
+        constexpr size_t DEFAULT_BACKTRACK_MEMORY = 32 * 1024 * 1024;  // 32 MiB
+        constexpr size_t DEFAULT_CHUNK_SIZE = 8 * 1024 * 1024;         // 8 MiB
+        constexpr size_t NO_MAX_COUNT = std::numeric_limits<size_t>::max();
+    }
+
+    // What a search prints. Later modes need less of each file, and take precedence when several are asked for.
+    enum class EOutputMode: uint8_t{
+        LINES,                  // Print every matched line.
+        COUNT,                  // Print how many lines of each file were matched.
+        FILES_WITH_MATCHES,     // Print the path of each file with a matched line, stopping at its first one.
+        QUIET,                  // Print nothing, stopping the whole search at the first matched line.
+    };
+
+    /**
+     * @brief Tunables shared by every search function.
+     */
+    struct SearchOptions{
+        size_t dfa_cache_size{priv::DEFAULT_DFA_CACHE_SIZE};  // Memory limit of the lazy DFA state cache, in bytes.
+        size_t mmap_threshold{priv::DEFAULT_MMAP_THRESHOLD};  // Files at least this large (in bytes) are memory-mapped instead of read.
+        size_t backtrack_memory{priv::DEFAULT_BACKTRACK_MEMORY};  // Memory limit of the backtracker's visited-state bitmap, per line, in bytes. Longer lines only use its memo.
+        bool whole_buffer{true};  // Search each file as a single buffer instead of matching it line by line.
+        uint32_t thread_count{1};  // How many files (or chunks of a large file) are searched concurrently.
+        size_t chunk_size{priv::DEFAULT_CHUNK_SIZE};  // With several threads, a file searched on its own is split into chunks of about this size (in bytes) if it holds at least two. 0 disables splitting.
+        bool ordered_output{false};  // When searching concurrently, print results in the same order as the files were given.
+        bool fixed_strings{false};  // Patterns are literal strings, all searched for at once.
+        bool show_pattern{false};  // When there are several patterns, write each matched line once per matching pattern, preceded by it.
+        EOutputMode output_mode{EOutputMode::LINES};  // What to print about the matched lines.
+        size_t max_count{priv::NO_MAX_COUNT};  // Stop searching a file (or the standard input) after this many matched lines.
+    };
+}
@@ -0,0 +1,44 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include "sparse_set.hpp"
+
+namespace cpp_grep{
+    SparseSet::SparseSet(uint capacity): dense(capacity), sparse(capacity){}
+
+    bool SparseSet::contains(uint value) const{
+        uint index = sparse[value];
+        return index < count && dense[index] == value;
+    }
+
+    bool SparseSet::empty() const{
+        return count == 0;
+    }
+
+    uint SparseSet::size() const{
+        return count;
+    }
+
+    uint SparseSet::at(uint index) const{
+        return dense[index];
+    }
+
+    const uint* SparseSet::begin() const{
+        return dense.data();
+    }
+
+    const uint* SparseSet::end() const{
+        return dense.data() + count;
+    }
+
+    void SparseSet::insert(uint value){
+        dense[count] = value;
+        sparse[value] = count;
+        count++;
+    }
+
+    void SparseSet::clear(){
+        count = 0;
+    }
+}
@@ -0,0 +1,47 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace cpp_grep{
+    using uint = uint32_t;
+
+    using std::vector;
+
+    /**
+     * @brief A set of instruction indices with O(1) insertion, lookup and clearing.
+     *
+     * Elements are kept in insertion order, which the automata rely on to walk their thread lists.
+     */
+    class SparseSet{
+        vector<uint> dense;
+        vector<uint> sparse;
+        uint count{0};
+
+        public:
+            /**
+             * Generate an empty set which cannot hold anything.
+             */
+            SparseSet() = default;
+
+            /**
+             * Generate an empty set able to hold every value in [0, capacity).
+             * @param capacity The amount of distinct values this set can hold.
+             */
+            explicit SparseSet(uint capacity);
+
+            [[nodiscard]] bool contains(uint value) const;
+            [[nodiscard]] bool empty() const;
+            [[nodiscard]] uint size() const;
+            [[nodiscard]] uint at(uint index) const;
+            [[nodiscard]] const uint* begin() const;
+            [[nodiscard]] const uint* end() const;
+
+            void insert(uint value);
+            void clear();
+    };
+}
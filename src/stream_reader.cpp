@@ -0,0 +1,217 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <cerrno>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include "stream_reader.hpp"
+
+namespace cpp_grep{
+    using std::lock_guard;
+    using std::make_shared;
+    using std::unique_lock;
+
+    namespace priv{
+        /**
+         * Read from a file descriptor, retrying if interrupted by a signal.
+         * @param fd The file descriptor to read from.
+         * @param data The buffer to fill.
+         * @param size The buffer's size.
+         * @return The amount of bytes read, 0 at the end of the file, or -1 on error.
+         */
+        ssize_t read_once(int fd, char* data, size_t size){
+            while (true){
+                ssize_t count = read(fd, data, size);
+                if (count >= 0 || errno != EINTR){
+                    return count;
+                }
+            }
+        }
+
+        /**
+         * Check if a file descriptor can be read from without blocking.
+         * @param fd The file descriptor.
+         * @return true if data (or the end of the file) is available right away, false otherwise.
+         */
+        bool can_read_now(int fd){
+            pollfd request{fd, POLLIN, 0};
+            return poll(&request, 1, 0) > 0;
+        }
+    }
+
+    StreamReader::SharedState::SharedState(int fd, size_t block_size): fd(fd){
+        for (auto& block: blocks){
+            block.resize(block_size);
+        }
+    }
+
+    StreamReader::StreamReader(int fd, size_t block_size)
+    : state(make_shared<SharedState>(fd, block_size)),
+      background(&StreamReader::read_blocks, state, block_size){
+    }
+
+    StreamReader::~StreamReader(){
+        bool finished;
+        {
+            lock_guard guard(state->lock);
+            state->stopping = true;
+            finished = state->finished;
+        }
+        state->changed.notify_all();
+        if (finished){
+            background.join();
+        }
+        else{
+            // Possibly blocked reading a stream which won't end anytime soon: it keeps the state alive on its own.
+            background.detach();
+        }
+    }
+
+    /**
+     * Fill the blocks in turn until the end of the stream, waiting for the caller to release each one before refilling it.
+     * Runs on the background thread.
+     * @param state The state shared with the reader.
+     * @param block_size The capacity of each block.
+     */
+    void StreamReader::read_blocks(const shared_ptr<SharedState>& state, size_t block_size){  // NOLINT
+        for (uint index = 0; ; index ^= 1){
+            {
+                unique_lock guard(state->lock);
+                state->changed.wait(guard, [&state, index](){ return !state->filled[index] || state->stopping; });
+                if (state->stopping){
+                    break;
+                }
+            }
+
+            // The caller doesn't touch an unfilled block, so it can be written to without holding the lock.
+            char* data = state->blocks[index].data();
+            size_t size = 0;
+            bool at_end = false;
+            do{
+                ssize_t count = priv::read_once(state->fd, data + size, block_size - size);
+                if (count <= 0){
+                    // Read errors end the stream, as unreadable files are skipped.
+                    at_end = true;
+                    break;
+                }
+                size += static_cast<size_t>(count);
+            } while (size < block_size && priv::can_read_now(state->fd));
+
+            {
+                lock_guard guard(state->lock);
+                state->sizes[index] = size;
+                state->filled[index] = true;
+                state->last[index] = at_end;
+            }
+            state->changed.notify_all();
+            if (at_end){
+                break;
+            }
+        }
+
+        {
+            lock_guard guard(state->lock);
+            state->finished = true;
+        }
+    }
+
+    /**
+     * Wait for the current block to be filled.
+     * @return true if it holds data, false if the stream ended before.
+     */
+    bool StreamReader::receive_block(){
+        unique_lock guard(state->lock);
+        state->changed.wait(guard, [this](){ return state->filled[current]; });
+        holding_block = true;
+        block_is_last = state->last[current];
+        offset = 0;
+        if (state->sizes[current] == 0){
+            // Only the last block can be empty.
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Hand the current block back to the background thread, and move on to the other one.
+     */
+    void StreamReader::release_block(){
+        {
+            lock_guard guard(state->lock);
+            state->filled[current] = false;
+        }
+        state->changed.notify_all();
+        holding_block = false;
+        current ^= 1;
+    }
+
+    /**
+     * Hand out the stream's last line, if it doesn't end with a newline, and mark the stream as ended.
+     * @param lines Set to the last line, if there is one.
+     * @return true if there was a last line to hand out, false otherwise.
+     */
+    bool StreamReader::hand_out_last_line(string_view& lines){
+        ended = true;
+        if (pending.empty()){
+            return false;
+        }
+        lines = pending;
+        return true;
+    }
+
+    bool StreamReader::next(string_view& lines){
+        if (ended){
+            return false;
+        }
+        if (pending_given){
+            pending.clear();
+            pending_given = false;
+        }
+
+        while (true){
+            if (!holding_block && !receive_block()){
+                // The end of the stream: hand out its last line if it doesn't end with a newline.
+                return hand_out_last_line(lines);
+            }
+
+            string_view rest(state->blocks[current].data() + offset, state->sizes[current] - offset);
+            if (rest.empty()){
+                bool was_last = block_is_last;
+                release_block();
+                if (was_last){
+                    // The background thread stopped after filling this block, so the other one never comes.
+                    return hand_out_last_line(lines);
+                }
+                continue;
+            }
+
+            if (!pending.empty()){
+                // Complete the line split across blocks first.
+                size_t newline = rest.find('\n');
+                if (newline == string_view::npos){
+                    pending.append(rest);
+                    offset += rest.size();
+                    continue;
+                }
+                pending.append(rest.substr(0, newline + 1));
+                offset += newline + 1;
+                lines = pending;
+                pending_given = true;
+                return true;
+            }
+
+            size_t last_newline = rest.rfind('\n');
+            if (last_newline == string_view::npos){
+                pending.assign(rest);
+                offset += rest.size();
+                continue;
+            }
+            lines = rest.substr(0, last_newline + 1);
+            offset += last_newline + 1;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,95 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace cpp_grep{
+    using uint = uint32_t;
+
+    using std::array;
+    using std::condition_variable;
+    using std::mutex;
+    using std::shared_ptr;
+    using std::string;
+    using std::string_view;
+    using std::thread;
+
+    /**
+     * @brief Reads a stream of unknown length (pipe, terminal...) on a background thread, handing it out as whole lines.
+     *
+     * The stream is read into two blocks in turn: while the caller searches the lines of one block,
+     * the next one is being filled. Each block is filled by a blocking read, followed by as many reads as
+     * there is data already available, so slow streams are handed out as soon as they are written to,
+     * and fast ones in large blocks.
+     * Memory usage is bounded by the two blocks, plus the longest line split across two of them.
+     */
+    class StreamReader{
+        // What the calling thread and the background thread share. The background thread holds it as well,
+        // so that the reader can be destroyed while it is still blocked reading.
+        struct SharedState{
+            int fd;
+            mutex lock;
+            condition_variable changed;
+            array<string, 2> blocks;
+            array<size_t, 2> sizes{};
+            array<bool, 2> filled{};    // Whether a block holds data the caller hasn't released yet.
+            array<bool, 2> last{};      // Whether a block ends the stream (the end or a read error was reached).
+            bool stopping{false};       // Whether the reader was destroyed.
+            bool finished{false};       // Whether the background thread is done.
+
+            SharedState(int fd, size_t block_size);
+        };
+
+        shared_ptr<SharedState> state;
+        thread background;
+
+        uint current{0};            // The block lines are currently handed out from.
+        bool holding_block{false};  // Whether the current block was received and not released yet.
+        bool block_is_last{false};  // Whether the current block ends the stream.
+        size_t offset{0};           // How much of the current block was handed out.
+        string pending;             // The start of a line split across two blocks.
+        bool pending_given{false};  // Whether pending was handed out, and must be emptied.
+        bool ended{false};          // Whether the end of the stream was handed out already.
+
+        static void read_blocks(const shared_ptr<SharedState>& state, size_t block_size);
+        bool receive_block();
+        void release_block();
+        bool hand_out_last_line(string_view& lines);
+
+        public:
+            /**
+             * Start reading a stream.
+             * @param fd The file descriptor to read from. It isn't closed by the reader.
+             * @param block_size The capacity of each of the two blocks, in bytes. Must not be 0.
+             */
+            StreamReader(int fd, size_t block_size);
+
+            /**
+             * Stop reading. If the background thread is still blocked reading, it is left to end on its own.
+             */
+            ~StreamReader();
+
+            StreamReader(const StreamReader&) = delete;
+            StreamReader& operator=(const StreamReader&) = delete;
+
+            /**
+             * @brief Get the next lines of the stream.
+             * Blocks until some are available.
+             * @param lines Set to one or more whole lines, each one ending with a newline (except the stream's last one).
+             * It stays valid until the next call.
+             * @return true if lines were read, false once the end of the stream is reached.
+             */
+            bool next(string_view& lines);
+    };
+}
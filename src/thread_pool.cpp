@@ -0,0 +1,136 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include "thread_pool.hpp"
+
+namespace cpp_grep{
+    using std::lock_guard;
+    using std::make_unique;
+    using std::unique_lock;
+
+    namespace priv{
+        // The pool and worker index of the current thread, if it is a pool worker.
+        thread_local const WorkStealingPool* current_pool = nullptr;
+        thread_local uint current_worker = 0;
+    }
+
+    WorkStealingPool::WorkStealingPool(uint thread_count){
+        queues.reserve(thread_count);
+        for (uint i = 0; i < thread_count; ++i){
+            queues.push_back(make_unique<WorkQueue>());
+        }
+        workers.reserve(thread_count);
+        for (uint i = 0; i < thread_count; ++i){
+            workers.emplace_back(&WorkStealingPool::worker_loop, this, i);
+        }
+    }
+
+    WorkStealingPool::~WorkStealingPool(){
+        wait();
+        {
+            lock_guard guard(state_lock);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (auto& worker: workers){
+            worker.join();
+        }
+    }
+
+    void WorkStealingPool::submit(Task task){
+        uint target;
+        if (priv::current_pool == this){
+            target = priv::current_worker;
+        }
+        else{
+            target = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+        }
+
+        pending_count.fetch_add(1);
+        {
+            lock_guard guard(queues[target]->lock);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        {
+            // Taken so a worker can't miss the wakeup between checking for work and sleeping.
+            lock_guard guard(state_lock);
+            queued_count.fetch_add(1);
+        }
+        work_available.notify_one();
+    }
+
+    /**
+     * Take a task from a worker's own queue, or steal one from another queue.
+     * @param worker The worker looking for a task.
+     * @param task Set to the task taken.
+     * @return true if a task was taken, false if every queue is empty.
+     */
+    bool WorkStealingPool::pop_task(uint worker, Task& task){
+        {
+            WorkQueue& own = *queues[worker];
+            lock_guard guard(own.lock);
+            if (!own.tasks.empty()){
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                queued_count.fetch_sub(1);
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset < queues.size(); ++offset){
+            WorkQueue& victim = *queues[(worker + offset) % queues.size()];
+            lock_guard guard(victim.lock);
+            if (!victim.tasks.empty()){
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                queued_count.fetch_sub(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Mark a task as finished, waking up wait() if it was the last one.
+     */
+    void WorkStealingPool::finish_task(){
+        if (pending_count.fetch_sub(1) == 1){
+            lock_guard guard(state_lock);
+            all_done.notify_all();
+        }
+    }
+
+    /**
+     * Run tasks until the pool stops.
+     * @param worker The index of this worker.
+     */
+    void WorkStealingPool::worker_loop(uint worker){
+        priv::current_pool = this;
+        priv::current_worker = worker;
+
+        Task task;
+        while (true){
+            if (pop_task(worker, task)){
+                task(worker);
+                task = nullptr;
+                finish_task();
+                continue;
+            }
+
+            unique_lock guard(state_lock);
+            work_available.wait(guard, [this](){ return stopping || queued_count.load() > 0; });
+            if (stopping && queued_count.load() == 0){
+                return;
+            }
+        }
+    }
+
+    void WorkStealingPool::wait(){
+        unique_lock guard(state_lock);
+        all_done.wait(guard, [this](){ return pending_count.load() == 0; });
+    }
+
+    uint WorkStealingPool::get_thread_count() const{
+        return static_cast<uint>(workers.size());
+    }
+}
@@ -0,0 +1,91 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cpp_grep{
+    using uint = uint32_t;
+
+    using std::atomic;
+    using std::condition_variable;
+    using std::deque;
+    using std::function;
+    using std::mutex;
+    using std::thread;
+    using std::unique_ptr;
+    using std::vector;
+
+    /**
+     * @brief A fixed set of worker threads, each with its own task queue.
+     *
+     * Workers run the most recently queued task of their own queue first (the one most likely to still be in cache)
+     * and steal the oldest task of another worker's queue when they run out of work.
+     * Tasks submitted from a worker go to that worker's queue, other tasks are spread over every queue.
+     */
+    class WorkStealingPool{
+        public:
+            // A task, given the index of the worker running it.
+            using Task = function<void(uint)>;
+
+        private:
+            struct WorkQueue{
+                mutex lock;
+                deque<Task> tasks;
+            };
+
+            vector<unique_ptr<WorkQueue>> queues;
+            vector<thread> workers;
+
+            mutex state_lock;
+            condition_variable work_available;
+            condition_variable all_done;
+            atomic<size_t> queued_count{0};     // Tasks waiting in a queue.
+            atomic<size_t> pending_count{0};    // Tasks submitted but not finished yet.
+            atomic<uint> next_queue{0};
+            bool stopping{false};
+
+            bool pop_task(uint worker, Task& task);
+            void finish_task();
+            void worker_loop(uint worker);
+
+        public:
+            /**
+             * Start a pool.
+             * @param thread_count The amount of worker threads. Must be at least 1.
+             */
+            explicit WorkStealingPool(uint thread_count);
+
+            /**
+             * Wait for every submitted task, then stop the workers.
+             */
+            ~WorkStealingPool();
+
+            WorkStealingPool(const WorkStealingPool&) = delete;
+            WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+            /**
+             * @brief Queue a task.
+             * Tasks may submit more tasks themselves.
+             * @param task The task to run.
+             */
+            void submit(Task task);
+
+            /**
+             * Block until every submitted task (including the ones they submitted) has finished.
+             */
+            void wait();
+
+            [[nodiscard]] uint get_thread_count() const;
+    };
+}
@@ -0,0 +1,73 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <atomic>
+#include <unistd.h>
+
+#include "trace.hpp"
+
+namespace cpp_grep{
+    using std::atomic;
+    using std::memory_order_relaxed;
+
+    namespace priv{
+        atomic<ETraceLevel> trace_level{ETraceLevel::OFF};
+
+        /**
+         * Get the prefix of messages of a given level.
+         * @param level The level.
+         * @return The prefix, including the separating space.
+         */
+        const char* trace_prefix(ETraceLevel level){
+            switch (level){
+                case ETraceLevel::INFO:
+                    return "[info] ";
+                case ETraceLevel::DEBUG:
+                    return "[debug] ";
+                default:
+                    return "[verbose] ";
+            }
+        }
+
+        void write_trace(ETraceLevel level, const string& message){
+            // Build the whole line first, so messages from several threads don't interleave.
+            string line = trace_prefix(level);
+            line += message;
+            line += '\n';
+            size_t written = 0;
+            while (written < line.size()){
+                ssize_t count = write(STDERR_FILENO, line.data() + written, line.size() - written);
+                if (count <= 0){
+                    return;
+                }
+                written += static_cast<size_t>(count);
+            }
+        }
+    }
+
+    void set_trace_level(ETraceLevel level){
+        priv::trace_level.store(level, memory_order_relaxed);
+    }
+
+    bool trace_enabled(ETraceLevel level){
+        return static_cast<ubyte>(level) <= static_cast<ubyte>(priv::trace_level.load(memory_order_relaxed))
+            && level != ETraceLevel::OFF;
+    }
+
+    bool parse_trace_level(const string& name, ETraceLevel& level){
+        if (name == "info"){
+            level = ETraceLevel::INFO;
+        }
+        else if (name == "debug"){
+            level = ETraceLevel::DEBUG;
+        }
+        else if (name == "verbose"){
+            level = ETraceLevel::VERBOSE;
+        }
+        else{
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,78 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+namespace cpp_grep{
+    using ubyte = uint8_t;
+
+    using std::ostringstream;
+    using std::string;
+
+    // Trace levels, from the least to the most verbose.
+    enum class ETraceLevel: ubyte{
+        OFF,
+        INFO,       // One-off events and statistics.
+        DEBUG,      // Once per line or file.
+        VERBOSE,    // Once per pattern portion or input character.
+    };
+
+    namespace priv{
+        /**
+         * Write a finished trace message to stderr, as a single write.
+         * @param level The message's level.
+         * @param message The message, without its trailing newline.
+         */
+        void write_trace(ETraceLevel level, const string& message);
+
+        /**
+         * Format a trace message and write it to stderr.
+         * @param level The message's level.
+         * @param args The values to print, one after another.
+         */
+        template<typename... Args> void trace(ETraceLevel level, const Args&... args){
+            ostringstream message;
+            (message << ... << args);
+            write_trace(level, message.str());
+        }
+    }
+
+    /**
+     * Set the most verbose level traces are printed at.
+     * @param level The new level. OFF disables tracing.
+     */
+    void set_trace_level(ETraceLevel level);
+
+    /**
+     * Check if messages of a given level are currently printed.
+     * @param level The level to check.
+     * @return true if messages of this level are printed, false otherwise.
+     */
+    [[nodiscard]] bool trace_enabled(ETraceLevel level);
+
+    /**
+     * Parse a trace level's name.
+     * @param name The level's name ("info", "debug" or "verbose").
+     * @param level Set to the parsed level.
+     * @return true if the name is valid, false otherwise.
+     */
+    bool parse_trace_level(const string& name, ETraceLevel& level);
+}
+
+// Tracing is compiled in debug builds only: in release builds (NDEBUG), trace points and their arguments vanish entirely.
+#ifndef NDEBUG
+    #define CPP_GREP_TRACING 1
+    #define CPP_GREP_TRACE(level, ...) \
+        do{ \
+            if (::cpp_grep::trace_enabled(::cpp_grep::ETraceLevel::level)){ \
+                ::cpp_grep::priv::trace(::cpp_grep::ETraceLevel::level, __VA_ARGS__); \
+            } \
+        } while (false)
+#else
+    #define CPP_GREP_TRACE(level, ...) do{} while (false)
+#endif
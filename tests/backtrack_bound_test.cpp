@@ -0,0 +1,59 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "line_matcher.hpp"
+
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace{
+    // Nested repetitions around a backreferenced group: without memoization, the line takes exponential time.
+    const string NESTED_PATTERN = "(a+)+b\\1c";
+
+    /**
+     * Match lines with a pattern, then check the outcome.
+     * The work has to stay bounded whatever the memory limit, which the test's timeout enforces.
+     * @param memory_limit The backtracker's memory limit.
+     * @param lines The lines to match, along with whether each one should be matched.
+     * @return true if every line was matched as expected, false otherwise.
+     */
+    bool check_lines(size_t memory_limit, const vector<pair<string, bool>>& lines){
+        cpp_grep::SearchOptions options;
+        options.backtrack_memory = memory_limit;
+        cpp_grep::CompiledPattern compiled({NESTED_PATTERN}, false);
+        cpp_grep::LineMatcher matcher(compiled, options);
+
+        bool success = true;
+        for (const auto& [line, expected]: lines){
+            if (matcher.matches(line) != expected){
+                std::fprintf(
+                    stderr, "%s, memory limit %zu, line of %zu bytes: expected %s\n",
+                    NESTED_PATTERN.c_str(), memory_limit, line.size(), expected ? "a match" : "no match"
+                );
+                success = false;
+            }
+        }
+        return success;
+    }
+}
+
+int main(){
+    // \1 has to match the a's following b, but there are fewer a's before b.
+    string too_short = string(800, 'a') + 'b' + string(801, 'a') + 'c';
+    string matched = string(800, 'a') + 'b' + string(800, 'a') + 'c';
+    vector<pair<string, bool>> lines{{too_short, false}, {matched, true}, {"aabaac", true}, {"abaac", false}};
+
+    bool success = true;
+    success &= check_lines(cpp_grep::priv::DEFAULT_BACKTRACK_MEMORY, lines);
+    // Too little memory for the bitmap: only the memo is used.
+    success &= check_lines(1, lines);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
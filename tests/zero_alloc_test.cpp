@@ -0,0 +1,117 @@
+//
+// Created by fortwoone on 16/10/2026.
+//
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "line_matcher.hpp"
+
+using std::atomic;
+using std::bad_alloc;
+using std::string;
+using std::string_view;
+using std::vector;
+
+namespace{
+    atomic<size_t> allocation_count{0};
+
+    /**
+     * Allocate memory, counting the allocation.
+     * @param size The amount of bytes to allocate.
+     * @return The allocated memory.
+     * @throw bad_alloc if the memory couldn't be allocated.
+     */
+    void* counted_alloc(size_t size){
+        allocation_count.fetch_add(1, std::memory_order_relaxed);
+        void* memory = std::malloc(size == 0 ? 1 : size);
+        if (memory == nullptr){
+            throw bad_alloc();
+        }
+        return memory;
+    }
+
+    /**
+     * Count the heap allocations made while matching lines with a warmed up matcher.
+     * @param pattern The pattern to match.
+     * @param lines The lines to match.
+     * @param expected How many of the lines the pattern should match.
+     * @return true if the lines were matched as expected without allocating, false otherwise.
+     */
+    bool check_pattern(const string& pattern, const vector<string>& lines, size_t expected){
+        cpp_grep::SearchOptions options;
+        cpp_grep::CompiledPattern compiled({pattern}, false);
+        cpp_grep::LineMatcher matcher(compiled, options);
+
+        // The first pass fills the engines' caches and grows their scratch memory.
+        for (const auto& line: lines){
+            (void)matcher.matches(line);
+        }
+
+        size_t before = allocation_count.load();
+        size_t matched = 0;
+        for (int pass = 0; pass < 10; ++pass){
+            for (const auto& line: lines){
+                matched += matcher.matches(string_view(line)) ? 1 : 0;
+            }
+        }
+        size_t allocations = allocation_count.load() - before;
+
+        if (matched != 10 * expected){
+            std::fprintf(stderr, "%s: matched %zu line(s) instead of %zu\n", pattern.c_str(), matched / 10, expected);
+            return false;
+        }
+        if (allocations != 0){
+            std::fprintf(stderr, "%s: %zu heap allocation(s) while matching\n", pattern.c_str(), allocations);
+            return false;
+        }
+        return true;
+    }
+}
+
+void* operator new(size_t size){
+    return counted_alloc(size);
+}
+
+void* operator new[](size_t size){
+    return counted_alloc(size);
+}
+
+void operator delete(void* memory) noexcept{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept{
+    std::free(memory);
+}
+
+int main(){
+    vector<string> lines{
+        "the the cat",
+        "a dog and a cat",
+        "abcabc",
+        "no repeated words here",
+        string(300, 'x') + " yy yy",
+        "",
+    };
+
+    bool success = true;
+    success &= check_pattern("(\\w+) \\1", lines, 2);
+    success &= check_pattern("([a-c]+)\\1", lines, 1);
+    success &= check_pattern("(a) \\w+ and \\1", lines, 1);
+    success &= check_pattern("^(\\w+) \\1", lines, 1);
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}